@@ -1,7 +1,9 @@
 #pragma once
 #include <cassert>
+#ifndef RAYTRACER_HEADLESS
 #include <SDL_keyboard.h>
 #include <SDL_mouse.h>
+#endif
 
 #include "Math.h"
 #include "Timer.h"
@@ -33,6 +35,9 @@ namespace dae
 
 		Matrix cameraToWorld{};
 
+		bool hasChanged{ true }; // Moved, rotated or zoomed during the last Update
+		uint32_t version{}; // Goes up every Update that changed the camera
+
 		Matrix CalculateCameraToWorld()
 		{
 			//todo: W2
@@ -54,6 +59,9 @@ namespace dae
 
 		void Update(Timer* pTimer)
 		{
+			hasChanged = false;
+
+#ifndef RAYTRACER_HEADLESS
 			const float deltaTime = pTimer->GetElapsed();
 
 			//Keyboard Input
@@ -69,8 +77,15 @@ namespace dae
 			MovementInput(pKeyboardState, deltaTime);
 
 			MouseInput(mouseState, mouseX, mouseY, deltaTime);
+#else
+			// No input without SDL, the camera only moves when set from code
+			(void)pTimer;
+#endif
+
+			if (hasChanged) ++version;
 		}
 
+#ifndef RAYTRACER_HEADLESS
 		void FOVInput(const uint8_t* pKeyboardState, float deltaTime)
 		{
 			// FOV Change
@@ -85,6 +100,7 @@ namespace dae
 				}
 
 				fovAngle += angleSpeed * deltaTime;
+				hasChanged = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_DOWN])
 			{
@@ -95,6 +111,7 @@ namespace dae
 				}
 
 				fovAngle -= angleSpeed * deltaTime;
+				hasChanged = true;
 			}
 		}
 		void MovementInput(const uint8_t* pKeyboardState, float deltaTime)
@@ -109,30 +126,36 @@ namespace dae
 			if (pKeyboardState[SDL_SCANCODE_W])
 			{
 				origin += forward * movementSpeed * deltaTime;
+				hasChanged = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_S])
 			{
 				origin -= forward * movementSpeed * deltaTime;
+				hasChanged = true;
 			}
 
 			// Y-axis
 			if (pKeyboardState[SDL_SCANCODE_Q])
 			{
 				origin -= up * movementSpeed * deltaTime;
+				hasChanged = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_E])
 			{
 				origin += up * movementSpeed * deltaTime;
+				hasChanged = true;
 			}
 
 			// X-axis
 			if (pKeyboardState[SDL_SCANCODE_A])
 			{
 				origin -= rightVector * movementSpeed * deltaTime;
+				hasChanged = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_D])
 			{
 				origin += rightVector * movementSpeed * deltaTime;
+				hasChanged = true;
 			}
 		}
 
@@ -149,8 +172,11 @@ namespace dae
 				
 				forward = rotationMatrix.TransformVector(Vector3::UnitZ);
 				forward.Normalize();
+
+				hasChanged = hasChanged || mouseX != 0 || mouseY != 0;
 			}
 		}
+#endif
 	};
 
 	
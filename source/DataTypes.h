@@ -1,7 +1,11 @@
 #pragma once
 #include <cassert>
 
+#include <cstdint>
+#include <memory>
+
 #include "Math.h"
+#include "VertexEncoding.h"
 #include "vector"
 
 namespace dae
@@ -23,6 +27,39 @@ namespace dae
 		unsigned char materialIndex{ 0 };
 	};
 
+	// Terms of the hit tests that only depend on the ray origin, the same for every ray leaving one point (e.g. the camera)
+	struct SphereOriginTerms
+	{
+		Vector3 sphereToRay{};
+		float C{};
+	};
+
+	struct PlaneOriginTerms
+	{
+		float rayToPlaneDot{};
+	};
+
+	// Shadow ray data of one light, rebuilt every frame by Scene::UpdateLightTerms
+	struct LightTerms
+	{
+		bool isAnchored{}; // Point light, shadow rays are traced from the light
+		std::vector<uint32_t> sphereIndices{};
+		std::vector<SphereOriginTerms> sphereTerms{};
+		std::vector<uint32_t> planeIndices{};
+		std::vector<PlaneOriginTerms> planeTerms{};
+		std::vector<uint32_t> triangleMeshIndices{};
+	};
+
+	// Everything the hit tests precalculate for one camera. A scene holds one, more cameras at once bring their own
+	struct ViewTerms
+	{
+		Vector3 origin{};
+		std::vector<SphereOriginTerms> sphereTerms{};
+		std::vector<PlaneOriginTerms> planeTerms{};
+		std::vector<LightTerms> lightTerms{};
+		std::vector<Plane> visibleBounds{};
+	};
+
 	enum class TriangleCullMode
 	{
 		FrontFaceCulling,
@@ -54,6 +91,16 @@ namespace dae
 		unsigned char materialIndex{};
 	};
 
+	// Node of a mesh BVH, children and triangles are indices so the array can be written to disk as is.
+	// Inner node (triangleCount 0): children at firstIdx and firstIdx + 1. Leaf: TriangleMesh::bvhTriangles[firstIdx, firstIdx + triangleCount)
+	struct BVHNode
+	{
+		Vector3 minAABB{};
+		uint32_t firstIdx{};
+		Vector3 maxAABB{};
+		uint32_t triangleCount{};
+	};
+
 	struct TriangleMesh
 	{
 		TriangleMesh() = default;
@@ -87,6 +134,36 @@ namespace dae
 		std::vector<Vector3> transformedPositions{};
 		std::vector<Vector3> transformedNormals{};
 
+		Vector3 transformedMinAABB{};
+		Vector3 transformedMaxAABB{};
+
+		// Optional (loaded meshes), built on positions, bounds refit to transformedPositions by UpdateTransforms.
+		// Empty: every triangle is tested
+		std::vector<BVHNode> bvhNodes{};
+		std::vector<uint32_t> bvhTriangles{};
+
+		// 16 bit indices instead of indices when every vertex fits (MeshOptimizer), indices is empty then.
+		// Read through GetIndex and GetIndexCount, WidenIndices for code that needs the int indices
+		std::vector<uint16_t> compactIndices{};
+
+		// Optional compact storage of the transformed vertices: 16 bit positions on a grid over the transformed bounds
+		// and 32 bit octahedral normals, the hit tests decode them. transformedPositions and transformedNormals stay empty then
+		bool useCompactVertices{ false };
+		std::vector<CompactPosition> compactPositions{};
+		std::vector<uint32_t> compactNormals{};
+		Vector3 compactOrigin{};
+		Vector3 compactStep{};
+
+		// Instance of a mesh that others share (glTF): the hit tests move the ray into the space of pInstancedMesh,
+		// this mesh keeps no vertices, indices or BVH of its own. Culling is the one of the shared mesh.
+		// instanceTransform goes from that space to the world, before scaleTransform, rotationTransform and translationTransform
+		std::shared_ptr<const TriangleMesh> pInstancedMesh{};
+		Matrix instanceTransform{};
+		Matrix worldToInstance{};
+		Matrix instanceNormalTransform{}; // Inverse transpose of the instance to world transform
+
+		uint32_t version{}; // Goes up every UpdateTransforms
+
 		void Translate(const Vector3& translation)
 		{
 			translationTransform = Matrix::CreateTranslation(translation);
@@ -104,6 +181,9 @@ namespace dae
 
 		void AppendTriangle(const Triangle& triangle, bool ignoreTransformUpdate = false)
 		{
+			// New vertices may not fit in 16 bits
+			WidenIndices();
+
 			int startIndex = static_cast<int>(positions.size());
 
 			positions.push_back(triangle.v0);
@@ -116,6 +196,10 @@ namespace dae
 
 			normals.push_back(triangle.normal);
 
+			// The BVH doesn't know the new triangle
+			bvhNodes.clear();
+			bvhTriangles.clear();
+
 			//Not ideal, but making sure all vertices are updated
 			if(!ignoreTransformUpdate)
 				UpdateTransforms();
@@ -127,10 +211,10 @@ namespace dae
 			Vector3 firstEdge{};
 			Vector3 secondEdge{};
 
-			for (size_t idx{}; idx < indices.size(); idx += 3)
+			for (size_t idx{}; idx < GetIndexCount(); idx += 3)
 			{
-				firstEdge = positions[indices[idx + 1]] - positions[indices[idx]];
-				secondEdge = positions[indices[idx + 2]] - positions[indices[idx + 1]];
+				firstEdge = positions[GetIndex(idx + 1)] - positions[GetIndex(idx)];
+				secondEdge = positions[GetIndex(idx + 2)] - positions[GetIndex(idx + 1)];
 
 				currentNormal = Vector3::Cross(firstEdge, secondEdge);
 				currentNormal.Normalize();
@@ -139,28 +223,218 @@ namespace dae
 			}
 		}
 
-		void UpdateTransforms()
+		size_t GetIndexCount() const { return compactIndices.empty() ? indices.size() : compactIndices.size(); }
+		size_t GetTriangleCount() const { return GetIndexCount() / 3; }
+
+		// The mesh the hit tests read the triangles of
+		const TriangleMesh& GetGeometry() const { return pInstancedMesh ? *pInstancedMesh : *this; }
+		int GetIndex(size_t idx) const { return compactIndices.empty() ? indices[idx] : compactIndices[idx]; }
+
+		// Moves the indices to compactIndices when every vertex fits in 16 bits, the int indices are freed
+		void NarrowIndices()
 		{
-			// Re-allocate memory
-			transformedPositions.clear();
-			transformedNormals.clear();
+			if (!compactIndices.empty() || positions.size() > size_t{ UINT16_MAX } + 1)
+			{
+				return;
+			}
 
-			transformedPositions.reserve(positions.size());
-			transformedNormals.reserve(normals.size());
+			compactIndices.assign(indices.begin(), indices.end());
+			std::vector<int>{}.swap(indices);
+		}
+
+		// Back to int indices, compactIndices is freed
+		void WidenIndices()
+		{
+			if (compactIndices.empty())
+			{
+				return;
+			}
 
+			indices.assign(compactIndices.begin(), compactIndices.end());
+			std::vector<uint16_t>{}.swap(compactIndices);
+		}
+
+		void UpdateTransforms()
+		{
 			//Calculate Final Transform 
 			const auto finalTransform = scaleTransform * rotationTransform * translationTransform;
 
-			//Transform Positions (positions > transformedPositions)
+			if (pInstancedMesh)
+			{
+				UpdateInstanceTransform(instanceTransform * finalTransform);
+				++version;
+				return;
+			}
+
+			if (useCompactVertices)
+			{
+				// Straight from the transform to the grid, no float copy of the vertices is made
+				EncodeCompactVertices(finalTransform);
+			}
+			else
+			{
+				// Re-allocate memory
+				transformedPositions.clear();
+				transformedNormals.clear();
+
+				transformedPositions.reserve(positions.size());
+				transformedNormals.reserve(normals.size());
+
+				//Transform Positions (positions > transformedPositions)
+				for (size_t idx{}; idx < positions.size(); ++idx)
+				{
+					transformedPositions.emplace_back(finalTransform.TransformPoint(positions[idx]));
+				}
+
+				//Transform Normals (normals > transformedNormals)
+				for (size_t idx{}; idx < normals.size(); ++idx)
+				{
+					transformedNormals.emplace_back(finalTransform.TransformVector(normals[idx]));
+				}
+			}
+
+			UpdateTransformedAABB();
+			RefitBVH();
+			++version;
+		}
+
+		// Ray transforms of an instance, its bounds are the shared mesh's bounds moved to the world
+		void UpdateInstanceTransform(const Matrix& instanceToWorld)
+		{
+			worldToInstance = Matrix::Inverse(instanceToWorld);
+			instanceNormalTransform = Matrix::Transpose(worldToInstance);
+
+			const Vector3& minAABB{ pInstancedMesh->transformedMinAABB };
+			const Vector3& maxAABB{ pInstancedMesh->transformedMaxAABB };
+			for (int cornerIdx{}; cornerIdx < 8; ++cornerIdx)
+			{
+				const Vector3 corner{ instanceToWorld.TransformPoint(cornerIdx & 1 ? maxAABB.x : minAABB.x,
+					cornerIdx & 2 ? maxAABB.y : minAABB.y, cornerIdx & 4 ? maxAABB.z : minAABB.z) };
+				transformedMinAABB = cornerIdx == 0 ? corner : Vector3::Min(transformedMinAABB, corner);
+				transformedMaxAABB = cornerIdx == 0 ? corner : Vector3::Max(transformedMaxAABB, corner);
+			}
+		}
+
+		// Transformed positions snapped to a grid over their bounds, the bounds and the BVH then hold what the hit tests decode.
+		// Transforms every position twice (bounds, then grid) instead of keeping a float copy
+		void EncodeCompactVertices(const Matrix& transform)
+		{
+			// Frees them when the mesh just switched to compact vertices, nothing to do otherwise
+			std::vector<Vector3>{}.swap(transformedPositions);
+			std::vector<Vector3>{}.swap(transformedNormals);
+
+			Vector3 minAABB{};
+			Vector3 maxAABB{};
 			for (size_t idx{}; idx < positions.size(); ++idx)
 			{
-				transformedPositions.emplace_back(finalTransform.TransformPoint(positions[idx]));
+				const Vector3 position{ transform.TransformPoint(positions[idx]) };
+				minAABB = idx == 0 ? position : Vector3::Min(minAABB, position);
+				maxAABB = idx == 0 ? position : Vector3::Max(maxAABB, position);
 			}
 
-			//Transform Normals (normals > transformedNormals)
+			compactOrigin = minAABB;
+			compactStep = VertexEncoding::GetGridStep(minAABB, maxAABB);
+
+			compactPositions.resize(positions.size());
+			for (size_t idx{}; idx < positions.size(); ++idx)
+			{
+				compactPositions[idx] = VertexEncoding::EncodePosition(transform.TransformPoint(positions[idx]), compactOrigin, compactStep);
+			}
+
+			// The hit test intersects the plane of the normal, one that doesn't fit the snapped corners opens cracks between triangles.
+			// Face normals are taken from the snapped triangle, facing the same side as the transformed normal
+			compactNormals.resize(normals.size());
 			for (size_t idx{}; idx < normals.size(); ++idx)
 			{
-				transformedNormals.emplace_back(finalTransform.TransformVector(normals[idx]));
+				Vector3 normal{ transform.TransformVector(normals[idx]) };
+				if (normals.size() * 3 == GetIndexCount())
+				{
+					const Vector3 v0{ GetTransformedPosition(GetIndex(idx * 3)) };
+					const Vector3 snappedNormal{ Vector3::Cross(GetTransformedPosition(GetIndex(idx * 3 + 1)) - v0, GetTransformedPosition(GetIndex(idx * 3 + 2)) - v0) };
+					if (snappedNormal.SqrMagnitude() > 0.f)
+					{
+						normal = Vector3::Dot(snappedNormal, normal) < 0.f ? -snappedNormal : snappedNormal;
+					}
+				}
+				compactNormals[idx] = VertexEncoding::EncodeNormal(normal);
+			}
+		}
+
+		// Decoded when the vertices are compact
+		Vector3 GetTransformedPosition(size_t idx) const
+		{
+			return useCompactVertices ? VertexEncoding::DecodePosition(compactPositions[idx], compactOrigin, compactStep) : transformedPositions[idx];
+		}
+
+		size_t GetTransformedPositionCount() const { return useCompactVertices ? compactPositions.size() : transformedPositions.size(); }
+
+		// Bytes of the transformed vertices the hit tests read, as stored or as the float arrays would take
+		size_t GetTransformedVertexBytes(bool asFloats = false) const
+		{
+			if (useCompactVertices && !asFloats)
+			{
+				return compactPositions.size() * sizeof(CompactPosition) + compactNormals.size() * sizeof(uint32_t);
+			}
+			return (positions.size() + normals.size()) * sizeof(Vector3);
+		}
+
+		// Bytes of the object space positions and normals, kept in floats either way to transform them again
+		size_t GetObjectVertexBytes() const
+		{
+			return (positions.size() + normals.size()) * sizeof(Vector3);
+		}
+
+		// World space bounds for the BVH nodes, children always come after their parent
+		void RefitBVH()
+		{
+			if (GetTransformedPositionCount() != positions.size())
+			{
+				return;
+			}
+
+			for (size_t nodeIdx{ bvhNodes.size() }; nodeIdx-- > 0;)
+			{
+				BVHNode& node{ bvhNodes[nodeIdx] };
+				if (node.triangleCount == 0)
+				{
+					node.minAABB = Vector3::Min(bvhNodes[node.firstIdx].minAABB, bvhNodes[node.firstIdx + 1].minAABB);
+					node.maxAABB = Vector3::Max(bvhNodes[node.firstIdx].maxAABB, bvhNodes[node.firstIdx + 1].maxAABB);
+					continue;
+				}
+
+				node.minAABB = node.maxAABB = GetTransformedPosition(GetIndex(size_t{ bvhTriangles[node.firstIdx] } * 3));
+				for (uint32_t idx{ node.firstIdx }; idx < node.firstIdx + node.triangleCount; ++idx)
+				{
+					for (uint32_t corner{}; corner < 3; ++corner)
+					{
+						const Vector3 position{ GetTransformedPosition(GetIndex(size_t{ bvhTriangles[idx] } * 3 + corner)) };
+						node.minAABB = Vector3::Min(node.minAABB, position);
+						node.maxAABB = Vector3::Max(node.maxAABB, position);
+					}
+				}
+
+				// Rays grazing an edge must not miss the box by a rounding error
+				const Vector3 margin{ (node.maxAABB - node.minAABB) * 1e-4f + Vector3{ 1e-6f, 1e-6f, 1e-6f } };
+				node.minAABB = node.minAABB - margin;
+				node.maxAABB = node.maxAABB + margin;
+			}
+		}
+
+		void UpdateTransformedAABB()
+		{
+			const size_t positionCount{ GetTransformedPositionCount() };
+			if (positionCount == 0)
+			{
+				transformedMinAABB = transformedMaxAABB = {};
+				return;
+			}
+
+			transformedMinAABB = transformedMaxAABB = GetTransformedPosition(0);
+			for (size_t idx{ 1 }; idx < positionCount; ++idx)
+			{
+				const Vector3 position{ GetTransformedPosition(idx) };
+				transformedMinAABB = Vector3::Min(transformedMinAABB, position);
+				transformedMaxAABB = Vector3::Max(transformedMaxAABB, position);
 			}
 		}
 	};
@@ -200,6 +474,19 @@ namespace dae
 
 		bool didHit{ false };
 		unsigned char materialIndex{ 0 };
+		int primitiveId{ -1 }; // Index of the hit object in the scene
+	};
+
+	//Version counter of every part of a scene
+	struct SceneVersions
+	{
+		uint32_t camera{};
+		uint32_t spheres{};
+		uint32_t planes{};
+		uint32_t triangleMeshes{};
+		uint32_t lights{};		// Added, moved or removed
+		uint32_t lightColors{};	// Only color or intensity changed
+		uint32_t materials{};
 	};
 #pragma endregion
 }
\ No newline at end of file
@@ -0,0 +1,237 @@
+//Standard includes
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#include <pthread.h>
+#endif
+
+//Project includes
+#include "FrameStream.h"
+#include "ToneMapper.h"
+
+namespace dae {
+
+	FrameStream::~FrameStream()
+	{
+		Close();
+	}
+
+	bool FrameStream::Open(const std::string& path, StreamFormat format, int width, int height, int framesPerSecond)
+	{
+		Close();
+
+		m_IsStdout = path == "-";
+		if (m_IsStdout)
+		{
+#ifdef _WIN32
+			// No \n -> \r\n translation in the pixel data
+			_setmode(_fileno(stdout), _O_BINARY);
+#endif
+			m_pFile = stdout;
+		}
+		else
+		{
+			// Blocks until a reader opens a named pipe
+			m_pFile = std::fopen(path.c_str(), "wb");
+			if (!m_pFile)
+			{
+				return false;
+			}
+		}
+
+		m_Format = format;
+		m_Width = width;
+		m_Height = height;
+		m_FramesPerSecond = framesPerSecond;
+		m_SubmitIdx = 0;
+		m_PendingIdx = -1;
+		m_IsClosing = false;
+		m_HasFailed = false;
+		m_WrittenCount = 0;
+		m_BlockedMs = 0.0;
+
+		m_Thread = std::thread{ &FrameStream::StreamLoop, this };
+		return true;
+	}
+
+	void FrameStream::Close()
+	{
+		if (!m_pFile)
+		{
+			return;
+		}
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsClosing = true;
+		}
+		m_FrameSubmitted.notify_one();
+		// Flushes or closes the file on its way out
+		m_Thread.join();
+		m_pFile = nullptr;
+	}
+
+	void FrameStream::Submit(const uint32_t* pPixels, const ToneMapper& toneMapper)
+	{
+		std::unique_lock lock{ m_Mutex };
+		if (!m_pFile || m_HasFailed)
+		{
+			return;
+		}
+
+		// The stream thread still has to pick up the last frame, it is busy with the buffer before that one
+		if (m_PendingIdx != -1)
+		{
+			const auto startTime{ std::chrono::steady_clock::now() };
+			m_FrameTaken.wait(lock, [this] { return m_PendingIdx == -1; });
+			m_BlockedMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		}
+
+		std::vector<uint32_t>& buffer{ m_Buffers[m_SubmitIdx] };
+		buffer.assign(pPixels, pPixels + static_cast<size_t>(m_Width) * m_Height);
+		m_pToneMapper = &toneMapper;
+
+		m_PendingIdx = m_SubmitIdx;
+		m_SubmitIdx = 1 - m_SubmitIdx;
+		lock.unlock();
+		m_FrameSubmitted.notify_one();
+	}
+
+	bool FrameStream::HasFailed() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_HasFailed;
+	}
+
+	uint32_t FrameStream::GetWrittenCount() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_WrittenCount;
+	}
+
+	double FrameStream::GetBlockedMs() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_BlockedMs;
+	}
+
+	void FrameStream::StreamLoop()
+	{
+#ifndef _WIN32
+		// A reader that quits early should show up as a failed write, not kill the process.
+		// SIGPIPE goes to the thread that wrote, blocked it stays pending here and is dropped when the thread ends
+		sigset_t pipeSignal{};
+		sigemptyset(&pipeSignal);
+		sigaddset(&pipeSignal, SIGPIPE);
+		pthread_sigmask(SIG_BLOCK, &pipeSignal, nullptr);
+#endif
+
+		const bool isHeaderWritten{ WriteHeader() };
+
+		std::unique_lock lock{ m_Mutex };
+		if (!isHeaderWritten)
+			m_HasFailed = true;
+
+		while (true)
+		{
+			// Frames submitted before Close are still written
+			m_FrameSubmitted.wait(lock, [this] { return m_IsClosing || m_PendingIdx != -1; });
+			if (m_PendingIdx == -1)
+			{
+				lock.unlock();
+				CloseFile();
+				return;
+			}
+
+			const int bufferIdx{ m_PendingIdx };
+			m_PendingIdx = -1;
+			lock.unlock();
+			m_FrameTaken.notify_one();
+
+			const bool isWritten{ WriteFrame(m_Buffers[bufferIdx]) };
+
+			lock.lock();
+			if (isWritten)
+				++m_WrittenCount;
+			else
+				m_HasFailed = true;
+		}
+	}
+
+	bool FrameStream::WriteHeader()
+	{
+		if (m_Format != StreamFormat::Y4M)
+		{
+			return true;
+		}
+
+		const std::string header{ "YUV4MPEG2 W" + std::to_string(m_Width) + " H" + std::to_string(m_Height)
+			+ " F" + std::to_string(m_FramesPerSecond) + ":1 Ip A1:1 C444\n" };
+		return std::fwrite(header.data(), 1, header.size(), m_pFile) == header.size();
+	}
+
+	bool FrameStream::WriteFrame(const std::vector<uint32_t>& pixels)
+	{
+		const size_t pixelCount{ pixels.size() };
+
+		switch (m_Format)
+		{
+		case StreamFormat::RGB:
+		case StreamFormat::RGBA:
+		{
+			const size_t channelCount{ m_Format == StreamFormat::RGBA ? size_t{ 4 } : size_t{ 3 } };
+			m_Bytes.resize(pixelCount * channelCount);
+			for (size_t pixelIdx{}; pixelIdx < pixelCount; ++pixelIdx)
+			{
+				uint8_t* pPixel{ &m_Bytes[pixelIdx * channelCount] };
+				m_pToneMapper->Unpack(pixels[pixelIdx], pPixel[0], pPixel[1], pPixel[2]);
+				if (channelCount == 4)
+					pPixel[3] = 255;
+			}
+			break;
+		}
+		case StreamFormat::Y4M:
+		{
+			// "FRAME\n", then full Y, Cb and Cr planes (BT.601, limited range)
+			constexpr char frameHeader[]{ "FRAME\n" };
+			constexpr size_t headerSize{ sizeof(frameHeader) - 1 };
+			m_Bytes.resize(headerSize + pixelCount * 3);
+			std::memcpy(m_Bytes.data(), frameHeader, headerSize);
+
+			uint8_t* pY{ m_Bytes.data() + headerSize };
+			uint8_t* pU{ pY + pixelCount };
+			uint8_t* pV{ pU + pixelCount };
+			for (size_t pixelIdx{}; pixelIdx < pixelCount; ++pixelIdx)
+			{
+				uint8_t r, g, b;
+				m_pToneMapper->Unpack(pixels[pixelIdx], r, g, b);
+
+				pY[pixelIdx] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+				pU[pixelIdx] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+				pV[pixelIdx] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+			}
+			break;
+		}
+		}
+
+		return std::fwrite(m_Bytes.data(), 1, m_Bytes.size(), m_pFile) == m_Bytes.size() && std::fflush(m_pFile) == 0;
+	}
+
+	void FrameStream::CloseFile()
+	{
+		if (m_IsStdout)
+		{
+			std::fflush(m_pFile);
+		}
+		else
+		{
+			std::fclose(m_pFile);
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	//Forward Declarations
+	class ToneMapper;
+
+	enum class StreamFormat
+	{
+		RGB,	// Raw 8 bit RGB, no framing (ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -i -)
+		RGBA,	// Raw 8 bit RGBA, alpha 255 (-pix_fmt rgba)
+		Y4M		// YUV4MPEG2 4:4:4 with header and FRAME markers (ffmpeg -i -)
+	};
+
+	//Streams frames to stdout or a (named) pipe for an external encoder.
+	//Double buffered: the render thread copies the surface pixels, the stream thread converts and writes the previous frame.
+	//Every write happens on the stream thread, which blocks SIGPIPE for itself only: a reader that quits is a failed write.
+	class FrameStream final
+	{
+	public:
+		FrameStream() = default;
+		~FrameStream();
+
+		FrameStream(const FrameStream&) = delete;
+		FrameStream(FrameStream&&) noexcept = delete;
+		FrameStream& operator=(const FrameStream&) = delete;
+		FrameStream& operator=(FrameStream&&) noexcept = delete;
+
+		// path "-" is stdout, false when the file/pipe can't be opened
+		bool Open(const std::string& path, StreamFormat format, int width, int height, int framesPerSecond = 30);
+		// Writes the frames still in flight and closes the output
+		void Close();
+
+		// Copies the packed pixels of a frame, only waits while the frame before the previous one is still being written
+		void Submit(const uint32_t* pPixels, const ToneMapper& toneMapper);
+
+		bool IsOpen() const { return m_pFile != nullptr; }
+		// Set once a write failed (e.g. the reader closed the pipe), later frames are dropped
+		bool HasFailed() const;
+		uint32_t GetWrittenCount() const;
+		// Time Submit spent waiting for the stream thread
+		double GetBlockedMs() const;
+
+	private:
+		FILE* m_pFile{};
+		bool m_IsStdout{};
+		StreamFormat m_Format{ StreamFormat::RGB };
+		int m_Width{};
+		int m_Height{};
+		int m_FramesPerSecond{};
+
+		std::thread m_Thread{};
+		mutable std::mutex m_Mutex{};
+		std::condition_variable m_FrameSubmitted{};
+		std::condition_variable m_FrameTaken{};
+
+		// Packed surface pixels, one buffer filled by Submit while the other is written
+		std::vector<uint32_t> m_Buffers[2]{};
+		const ToneMapper* m_pToneMapper{};
+		int m_SubmitIdx{};
+		int m_PendingIdx{ -1 };
+		bool m_IsClosing{ false };
+		bool m_HasFailed{ false };
+		uint32_t m_WrittenCount{};
+		double m_BlockedMs{};
+
+		// Converted frame, only touched by the stream thread
+		std::vector<uint8_t> m_Bytes{};
+
+		void StreamLoop();
+		bool WriteHeader();
+		bool WriteFrame(const std::vector<uint32_t>& pixels);
+		void CloseFile();
+	};
+}
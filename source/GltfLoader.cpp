@@ -0,0 +1,582 @@
+//Standard includes
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+//Project includes
+#include "GltfLoader.h"
+#include "MappedFile.h"
+
+namespace dae {
+
+	namespace
+	{
+		constexpr uint32_t g_GlbMagic{ 0x46546C67 };		// "glTF"
+		constexpr uint32_t g_JsonChunkType{ 0x4E4F534A };	// "JSON"
+		constexpr uint32_t g_BinChunkType{ 0x004E4942 };	// "BIN\0"
+		// Nesting deeper than this is a broken (or hostile) file
+		constexpr int g_MaxJsonDepth{ 64 };
+		// Largest integer a double holds exactly, counts, offsets and indices above it are rejected
+		constexpr double g_MaxJsonInteger{ 9007199254740992.0 };
+
+		enum GltfComponentType
+		{
+			UnsignedByte = 5121,
+			UnsignedShort = 5123,
+			UnsignedInt = 5125,
+			Float = 5126
+		};
+
+		// False for negative, fractional, too large or non-finite numbers, casting those to size_t is undefined
+		bool ToSize(double number, size_t& size)
+		{
+			if (!(number >= 0.0 && number <= g_MaxJsonInteger) || number != std::floor(number))
+				return false;
+
+			size = static_cast<size_t>(number);
+			return true;
+		}
+
+		struct JsonValue
+		{
+			enum class Type
+			{
+				Null,
+				Bool,
+				Number,
+				String,
+				Array,
+				Object
+			};
+
+			Type type{ Type::Null };
+			bool boolean{};
+			double number{};
+			std::string string{};
+			std::vector<JsonValue> items{};
+			std::vector<std::pair<std::string, JsonValue>> members{};
+
+			const JsonValue* Find(const char* key) const
+			{
+				for (const auto& [name, value] : members)
+				{
+					if (name == key)
+						return &value;
+				}
+				return nullptr;
+			}
+
+			double GetNumber(const char* key, double defaultValue) const
+			{
+				const JsonValue* pValue{ Find(key) };
+				return pValue && pValue->type == Type::Number ? pValue->number : defaultValue;
+			}
+
+			// Count, offset or length: defaultValue when missing, false when it isn't a size (ToSize)
+			bool GetSize(const char* key, size_t defaultValue, size_t& size) const
+			{
+				const JsonValue* pValue{ Find(key) };
+				if (!pValue)
+				{
+					size = defaultValue;
+					return true;
+				}
+				return pValue->type == Type::Number && ToSize(pValue->number, size);
+			}
+
+			// Index into one of the top level arrays, SIZE_MAX when missing or not a size
+			size_t GetIndex(const char* key) const
+			{
+				const JsonValue* pValue{ Find(key) };
+				return pValue ? pValue->AsIndex() : SIZE_MAX;
+			}
+
+			size_t AsIndex() const
+			{
+				size_t index{};
+				return type == Type::Number && ToSize(number, index) ? index : SIZE_MAX;
+			}
+
+			// Empty array when missing, saves a check at every loop
+			const std::vector<JsonValue>& GetItems(const char* key) const
+			{
+				static const std::vector<JsonValue> empty{};
+				const JsonValue* pValue{ Find(key) };
+				return pValue && pValue->type == Type::Array ? pValue->items : empty;
+			}
+		};
+
+		// Just enough JSON for glTF: no \u escapes beyond ASCII
+		struct JsonParser
+		{
+			const char* p{};
+			const char* pEnd{};
+
+			void SkipSpaces()
+			{
+				while (p < pEnd && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+					++p;
+			}
+
+			bool Consume(const char* literal)
+			{
+				const size_t length{ std::strlen(literal) };
+				if (static_cast<size_t>(pEnd - p) < length || std::memcmp(p, literal, length) != 0)
+					return false;
+				p += length;
+				return true;
+			}
+
+			bool ParseString(std::string& string)
+			{
+				if (p == pEnd || *p != '"')
+					return false;
+				++p;
+
+				while (p < pEnd && *p != '"')
+				{
+					if (*p != '\\')
+					{
+						string += *p++;
+						continue;
+					}
+
+					if (++p == pEnd)
+						return false;
+					switch (*p++)
+					{
+					case 'n': string += '\n'; break;
+					case 't': string += '\t'; break;
+					case 'r': string += '\r'; break;
+					case 'b': string += '\b'; break;
+					case 'f': string += '\f'; break;
+					case 'u':
+					{
+						unsigned int code{};
+						if (pEnd - p < 4 || std::from_chars(p, p + 4, code, 16).ptr != p + 4)
+							return false;
+						p += 4;
+						string += code < 0x80 ? static_cast<char>(code) : '?';
+						break;
+					}
+					default: string += p[-1]; break;
+					}
+				}
+
+				if (p == pEnd)
+					return false;
+				++p;
+				return true;
+			}
+
+			bool Parse(JsonValue& value, int depth)
+			{
+				SkipSpaces();
+				if (p == pEnd || depth > g_MaxJsonDepth)
+					return false;
+
+				switch (*p)
+				{
+				case '{':
+				{
+					value.type = JsonValue::Type::Object;
+					++p;
+					SkipSpaces();
+					if (p < pEnd && *p == '}')
+					{
+						++p;
+						return true;
+					}
+
+					while (true)
+					{
+						SkipSpaces();
+						std::pair<std::string, JsonValue> member{};
+						if (!ParseString(member.first))
+							return false;
+
+						SkipSpaces();
+						if (!Consume(":") || !Parse(member.second, depth + 1))
+							return false;
+						value.members.push_back(std::move(member));
+
+						SkipSpaces();
+						if (Consume("}"))
+							return true;
+						if (!Consume(","))
+							return false;
+					}
+				}
+				case '[':
+				{
+					value.type = JsonValue::Type::Array;
+					++p;
+					SkipSpaces();
+					if (p < pEnd && *p == ']')
+					{
+						++p;
+						return true;
+					}
+
+					while (true)
+					{
+						value.items.emplace_back();
+						if (!Parse(value.items.back(), depth + 1))
+							return false;
+
+						SkipSpaces();
+						if (Consume("]"))
+							return true;
+						if (!Consume(","))
+							return false;
+					}
+				}
+				case '"':
+					value.type = JsonValue::Type::String;
+					return ParseString(value.string);
+				case 't':
+					value.type = JsonValue::Type::Bool;
+					value.boolean = true;
+					return Consume("true");
+				case 'f':
+					value.type = JsonValue::Type::Bool;
+					return Consume("false");
+				case 'n':
+					return Consume("null");
+				default:
+				{
+					value.type = JsonValue::Type::Number;
+					const auto [pNext, error] { std::from_chars(p, pEnd, value.number) };
+					p = pNext;
+					return error == std::errc{};
+				}
+				}
+			}
+		};
+
+		// Start and stride of the elements of an accessor inside the BIN chunk, checked against its bounds
+		struct AccessorView
+		{
+			const char* pData{};
+			size_t count{};
+			size_t stride{};
+			int componentType{};
+		};
+
+		bool GetAccessorView(const JsonValue& json, const char* pBin, size_t binSize, size_t accessorIdx, const char* type, AccessorView& view)
+		{
+			const std::vector<JsonValue>& accessors{ json.GetItems("accessors") };
+			if (accessorIdx >= accessors.size())
+				return false;
+
+			const JsonValue& accessor{ accessors[accessorIdx] };
+			const JsonValue* pType{ accessor.Find("type") };
+			if (!pType || pType->string != type || accessor.Find("sparse"))
+				return false;
+
+			const std::vector<JsonValue>& bufferViews{ json.GetItems("bufferViews") };
+			const size_t viewIdx{ accessor.GetIndex("bufferView") };
+			if (viewIdx >= bufferViews.size())
+				return false;
+
+			const JsonValue& bufferView{ bufferViews[viewIdx] };
+			if (bufferView.GetNumber("buffer", 0.0) != 0.0)
+				return false;
+
+			size_t componentType{};
+			if (!accessor.GetSize("componentType", 0, componentType) || !accessor.GetSize("count", 0, view.count))
+				return false;
+
+			size_t componentSize{};
+			switch (componentType)
+			{
+			case UnsignedByte:	componentSize = 1; break;
+			case UnsignedShort:	componentSize = 2; break;
+			case UnsignedInt:
+			case Float:			componentSize = 4; break;
+			default:			return false;
+			}
+			view.componentType = static_cast<int>(componentType);
+			const size_t elementSize{ componentSize * (std::strcmp(type, "VEC3") == 0 ? 3 : 1) };
+
+			size_t viewOffset{};
+			size_t viewLength{};
+			size_t accessorOffset{};
+			if (!bufferView.GetSize("byteOffset", 0, viewOffset) || !bufferView.GetSize("byteLength", 0, viewLength)
+				|| !accessor.GetSize("byteOffset", 0, accessorOffset) || !bufferView.GetSize("byteStride", 0, view.stride))
+				return false;
+			if (view.stride == 0)
+				view.stride = elementSize;
+
+			// Last element has to end inside the view, the view inside the BIN chunk.
+			// Divided instead of multiplied, (count - 1) * stride can wrap around to a small number
+			if (viewOffset > binSize || viewLength > binSize - viewOffset || view.stride < elementSize)
+				return false;
+			if (view.count > 0 && (accessorOffset > viewLength || elementSize > viewLength - accessorOffset
+				|| view.count - 1 > (viewLength - accessorOffset - elementSize) / view.stride))
+				return false;
+
+			view.pData = pBin + viewOffset + accessorOffset;
+			return true;
+		}
+
+		bool ReadPositions(const AccessorView& view, std::vector<Vector3>& positions)
+		{
+			if (view.componentType != Float)
+				return false;
+
+			positions.resize(view.count);
+			if (view.count == 0)
+				return true;
+
+			if (view.stride == sizeof(Vector3))
+			{
+				// Tightly packed, the whole view in one go
+				std::memcpy(positions.data(), view.pData, view.count * sizeof(Vector3));
+				return true;
+			}
+
+			for (size_t idx{}; idx < view.count; ++idx)
+			{
+				std::memcpy(&positions[idx], view.pData + idx * view.stride, sizeof(Vector3));
+			}
+			return true;
+		}
+
+		bool ReadIndices(const AccessorView& view, std::vector<int>& indices)
+		{
+			indices.resize(view.count);
+			for (size_t idx{}; idx < view.count; ++idx)
+			{
+				const char* pIndex{ view.pData + idx * view.stride };
+				switch (view.componentType)
+				{
+				case UnsignedByte:	indices[idx] = static_cast<uint8_t>(*pIndex); break;
+				case UnsignedShort:	{ uint16_t index; std::memcpy(&index, pIndex, 2); indices[idx] = index; break; }
+				case UnsignedInt:	{ uint32_t index; std::memcpy(&index, pIndex, 4); indices[idx] = static_cast<int>(index); break; }
+				default:			return false;
+				}
+			}
+			return true;
+		}
+
+		float GetItem(const std::vector<JsonValue>& items, size_t idx, float defaultValue)
+		{
+			return idx < items.size() && items[idx].type == JsonValue::Type::Number ? static_cast<float>(items[idx].number) : defaultValue;
+		}
+
+		// Row vector matrix of a node, from "matrix" (column major, the same memory layout) or translation, rotation and scale
+		Matrix GetNodeTransform(const JsonValue& node)
+		{
+			const std::vector<JsonValue>& matrix{ node.GetItems("matrix") };
+			if (matrix.size() == 16)
+			{
+				Matrix transform{};
+				for (int row{}; row < 4; ++row)
+				{
+					transform[row] = Vector4{ GetItem(matrix, row * 4, 0.f), GetItem(matrix, row * 4 + 1, 0.f),
+						GetItem(matrix, row * 4 + 2, 0.f), GetItem(matrix, row * 4 + 3, 0.f) };
+				}
+				return transform;
+			}
+
+			const std::vector<JsonValue>& translation{ node.GetItems("translation") };
+			const std::vector<JsonValue>& rotation{ node.GetItems("rotation") };
+			const std::vector<JsonValue>& scale{ node.GetItems("scale") };
+
+			// Unit quaternion x, y, z, w, rows are the rotated axes
+			const float x{ GetItem(rotation, 0, 0.f) };
+			const float y{ GetItem(rotation, 1, 0.f) };
+			const float z{ GetItem(rotation, 2, 0.f) };
+			const float w{ GetItem(rotation, 3, 1.f) };
+			const Matrix rotationTransform{
+				Vector3{ 1.f - 2.f * (y * y + z * z), 2.f * (x * y + z * w), 2.f * (x * z - y * w) },
+				Vector3{ 2.f * (x * y - z * w), 1.f - 2.f * (x * x + z * z), 2.f * (y * z + x * w) },
+				Vector3{ 2.f * (x * z + y * w), 2.f * (y * z - x * w), 1.f - 2.f * (x * x + y * y) },
+				Vector3{} };
+
+			return Matrix::CreateScale(GetItem(scale, 0, 1.f), GetItem(scale, 1, 1.f), GetItem(scale, 2, 1.f))
+				* rotationTransform
+				* Matrix::CreateTranslation(Vector3{ GetItem(translation, 0, 0.f), GetItem(translation, 1, 0.f), GetItem(translation, 2, 0.f) });
+		}
+	}
+
+	bool GltfLoader::ParseGLB(const std::string& path, GltfData& data, MeshLoadStats* pStats)
+	{
+		const auto startTime{ std::chrono::steady_clock::now() };
+
+		MappedFile file{};
+		if (!file.Open(path) || file.GetSize() < 20)
+			return false;
+
+		// Header, then chunks of (length, type, data)
+		const char* pFile{ file.GetData() };
+		uint32_t header[3]{};
+		std::memcpy(header, pFile, sizeof(header));
+		if (header[0] != g_GlbMagic || header[1] != 2 || header[2] > file.GetSize())
+			return false;
+
+		const char* pJson{};
+		size_t jsonSize{};
+		const char* pBin{};
+		size_t binSize{};
+		for (size_t offset{ 12 }; offset + 8 <= header[2];)
+		{
+			uint32_t chunk[2]{};
+			std::memcpy(chunk, pFile + offset, sizeof(chunk));
+			offset += 8;
+			if (chunk[0] > header[2] - offset)
+				return false;
+
+			if (chunk[1] == g_JsonChunkType && !pJson)
+			{
+				pJson = pFile + offset;
+				jsonSize = chunk[0];
+			}
+			else if (chunk[1] == g_BinChunkType && !pBin)
+			{
+				pBin = pFile + offset;
+				binSize = chunk[0];
+			}
+			offset += chunk[0];
+		}
+
+		JsonValue json{};
+		JsonParser parser{ pJson, pJson + jsonSize };
+		if (!pJson || !parser.Parse(json, 0) || json.type != JsonValue::Type::Object)
+			return false;
+
+		// Only the BIN chunk, no external files or data URIs
+		const std::vector<JsonValue>& buffers{ json.GetItems("buffers") };
+		if (buffers.size() > 1 || (buffers.size() == 1 && buffers[0].Find("uri")))
+			return false;
+
+		data = GltfData{};
+
+		for (const JsonValue& material : json.GetItems("materials"))
+		{
+			GltfMaterial gltfMaterial{};
+			if (const JsonValue* pPbr{ material.Find("pbrMetallicRoughness") })
+			{
+				const std::vector<JsonValue>& baseColor{ pPbr->GetItems("baseColorFactor") };
+				gltfMaterial.baseColor = { GetItem(baseColor, 0, 1.f), GetItem(baseColor, 1, 1.f), GetItem(baseColor, 2, 1.f) };
+				gltfMaterial.metallic = static_cast<float>(pPbr->GetNumber("metallicFactor", 1.0));
+				gltfMaterial.roughness = static_cast<float>(pPbr->GetNumber("roughnessFactor", 1.0));
+			}
+			const JsonValue* pDoubleSided{ material.Find("doubleSided") };
+			gltfMaterial.isDoubleSided = pDoubleSided && pDoubleSided->boolean;
+			data.materials.push_back(gltfMaterial);
+		}
+
+		// Primitives of every mesh, decoded once however many nodes use the mesh
+		const std::vector<JsonValue>& meshes{ json.GetItems("meshes") };
+		std::vector<std::vector<size_t>> meshPrimitives(meshes.size());
+		for (size_t meshIdx{}; meshIdx < meshes.size(); ++meshIdx)
+		{
+			for (const JsonValue& primitive : meshes[meshIdx].GetItems("primitives"))
+			{
+				// Triangle lists only, points, lines, strips and fans are skipped
+				const JsonValue* pAttributes{ primitive.Find("attributes") };
+				if (primitive.GetNumber("mode", 4.0) != 4.0 || !pAttributes)
+					continue;
+
+				GltfPrimitive gltfPrimitive{};
+				AccessorView view{};
+				if (!GetAccessorView(json, pBin, binSize, pAttributes->GetIndex("POSITION"), "VEC3", view)
+					|| !ReadPositions(view, gltfPrimitive.mesh.positions))
+				{
+					return false;
+				}
+
+				// Without indices every 3 vertices are a triangle
+				std::vector<int>& indices{ gltfPrimitive.mesh.indices };
+				if (primitive.Find("indices"))
+				{
+					if (!GetAccessorView(json, pBin, binSize, primitive.GetIndex("indices"), "SCALAR", view)
+						|| !ReadIndices(view, indices))
+					{
+						return false;
+					}
+				}
+				else
+				{
+					indices.resize(gltfPrimitive.mesh.positions.size());
+					for (size_t idx{}; idx < indices.size(); ++idx)
+						indices[idx] = static_cast<int>(idx);
+				}
+
+				indices.resize(indices.size() / 3 * 3);
+				const int vertexCount{ static_cast<int>(gltfPrimitive.mesh.positions.size()) };
+				for (const int index : indices)
+				{
+					if (index < 0 || index >= vertexCount)
+						return false;
+				}
+
+				const size_t materialIdx{ primitive.GetIndex("material") };
+				gltfPrimitive.materialIdx = materialIdx < data.materials.size() ? static_cast<int>(materialIdx) : -1;
+
+				meshPrimitives[meshIdx].push_back(data.primitives.size());
+				data.primitives.push_back(std::move(gltfPrimitive));
+			}
+		}
+
+		// glTF is right-handed, this space is left-handed: mirror z after every other transform
+		const Matrix toLeftHanded{ Matrix::CreateScale(1.f, 1.f, -1.f) };
+
+		const std::vector<JsonValue>& nodes{ json.GetItems("nodes") };
+		std::function<bool(size_t, const Matrix&, int)> addNode = [&](size_t nodeIdx, const Matrix& parentTransform, int depth)
+		{
+			// Also stops cycles
+			if (nodeIdx >= nodes.size() || depth > g_MaxJsonDepth)
+				return false;
+
+			const JsonValue& node{ nodes[nodeIdx] };
+			const Matrix worldTransform{ GetNodeTransform(node) * parentTransform };
+
+			const size_t meshIdx{ node.GetIndex("mesh") };
+			if (meshIdx < meshPrimitives.size())
+			{
+				for (const size_t primitiveIdx : meshPrimitives[meshIdx])
+				{
+					data.instances.push_back({ primitiveIdx, worldTransform * toLeftHanded });
+				}
+			}
+
+			for (const JsonValue& child : node.GetItems("children"))
+			{
+				if (!addNode(child.AsIndex(), worldTransform, depth + 1))
+					return false;
+			}
+			return true;
+		};
+
+		// Roots of the default scene, or of the first one
+		const std::vector<JsonValue>& scenes{ json.GetItems("scenes") };
+		const size_t sceneIdx{ json.Find("scene") ? json.GetIndex("scene") : 0 };
+		if (sceneIdx < scenes.size())
+		{
+			for (const JsonValue& root : scenes[sceneIdx].GetItems("nodes"))
+			{
+				if (!addNode(root.AsIndex(), Matrix{}, 0))
+					return false;
+			}
+		}
+
+		if (pStats)
+		{
+			pStats->byteCount = file.GetSize();
+			pStats->triangleCount = 0;
+			for (const GltfInstance& instance : data.instances)
+			{
+				pStats->triangleCount += data.primitives[instance.primitiveIdx].mesh.GetTriangleCount();
+			}
+			pStats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		}
+		return true;
+	}
+}
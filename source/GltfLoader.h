@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Math.h"
+#include "ColorRGB.h"
+#include "DataTypes.h"
+#include "MeshLoader.h"
+
+namespace dae
+{
+	// pbrMetallicRoughness factors, textures are ignored
+	struct GltfMaterial
+	{
+		ColorRGB baseColor{ 1.f, 1.f, 1.f };
+		float metallic{ 1.f };
+		float roughness{ 1.f };
+		bool isDoubleSided{ false };
+	};
+
+	// One triangle primitive of a glTF mesh, positions and indices in its own (object) space
+	struct GltfPrimitive
+	{
+		TriangleMesh mesh{};
+		int materialIdx{ -1 };		// -1: glTF default material
+	};
+
+	// A primitive placed by a node, worldTransform already holds the parent nodes and the switch to this left-handed space
+	struct GltfInstance
+	{
+		size_t primitiveIdx{};
+		Matrix worldTransform{};
+	};
+
+	struct GltfData
+	{
+		std::vector<GltfPrimitive> primitives{};
+		std::vector<GltfMaterial> materials{};
+		std::vector<GltfInstance> instances{};
+	};
+
+	namespace GltfLoader
+	{
+		// Binary glTF 2.0: the JSON chunk, the BIN chunk as the only buffer, triangle primitives with float positions
+		// and 8/16/32 bit indices, the node hierarchy of the default scene and pbrMetallicRoughness factors.
+		// False on anything else than a .glb, external buffers, sparse accessors or data outside the BIN chunk.
+		bool ParseGLB(const std::string& path, GltfData& data, MeshLoadStats* pStats = nullptr);
+	}
+}
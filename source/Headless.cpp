@@ -0,0 +1,550 @@
+//Standard includes
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+//Project includes
+#include "Headless.h"
+#include "ImageWriter.h"
+#include "FrameStream.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+
+namespace dae {
+
+	namespace
+	{
+		struct HeadlessOptions
+		{
+			std::string sceneName{ "ReferenceScene_W4" };
+			int width{ 640 };
+			int height{ 480 };
+			int frameCount{ 1 };
+			int threadCount{ static_cast<int>(std::thread::hardware_concurrency()) };
+			std::string outputPath{};
+			std::string sequencePath{};
+			int encoderCount{ 2 };
+			std::string streamPath{};
+			StreamFormat streamFormat{ StreamFormat::Y4M };
+			int framesPerSecond{ 30 };
+
+			// Only this window of the width x height image is rendered and saved
+			bool isCropped{ false };
+			int cropX{};
+			int cropY{};
+			int cropWidth{};
+			int cropHeight{};
+
+			// Rows rendered at once for --output, 0 renders the whole image in one go
+			int stripHeight{};
+
+			// Turntable of this many cameras around the scene camera's target, rendered as one batch
+			int viewCount{};
+
+			// Meshes load from (and write) the binary cache next to their file
+			bool useMeshCache{ true };
+			// Loaded meshes go through MeshOptimizer
+			bool optimizeMeshes{ true };
+			// Transformed mesh vertices as 16 bit positions and octahedral normals
+			bool useCompactVertices{ false };
+		};
+
+		void PrintUsage()
+		{
+			std::cout << "Usage: RayTracer --headless [options]\n"
+				<< "  --scene <name>    scene to render, or the path of a .glb file (default ReferenceScene_W4)\n"
+				<< "  --width <pixels>  (default 640)\n"
+				<< "  --height <pixels> (default 480)\n"
+				<< "  --frames <count>  frames to render, the scene is updated in between (default 1)\n"
+				<< "  --threads <count> render threads (default: all cores)\n"
+				<< "  --output <path>   save the last frame (.png, .ppm or linear .pfm)\n"
+				<< "  --sequence <path> save every frame, numbered (frame.png -> frame_0000.png, ...)\n"
+				<< "  --encoders <count> image encoding threads for --sequence (default 2)\n"
+				<< "  --stream <path>   stream every frame to a named pipe, - is stdout (log goes to stderr)\n"
+				<< "  --stream-format <rgb|rgba|y4m> (default y4m)\n"
+				<< "  --fps <count>     frame rate in the y4m header (default 30)\n"
+				<< "  --crop <x,y,w,h>  only render this window of the width x height image, output is w x h\n"
+				<< "  --strip-height <rows> render --output (.ppm) in strips of this many rows, memory stays that of one strip\n"
+				<< "  --views <count>   render a turntable of cameras around the scene camera's target in one batch, numbered --output images\n"
+				<< "  --mesh-cache <on|off> load meshes from the .rtmesh cache next to them, written on the first load (default on)\n"
+				<< "  --mesh-optimize <on|off> weld vertices, drop degenerate triangles and sort meshes along a Morton curve on load (default on)\n"
+				<< "  --compact-vertices <on|off> store transformed mesh vertices as 16 bit positions and 32 bit normals (default off)\n"
+				<< "Scenes:";
+			for (const std::string& sceneName : GetSceneNames())
+			{
+				std::cout << " " << sceneName;
+			}
+			std::cout << std::endl;
+		}
+
+		// False on unknown options or missing/invalid values
+		bool ParseOptions(int argc, char* args[], HeadlessOptions& options)
+		{
+			for (int argIdx{ 1 }; argIdx < argc; ++argIdx)
+			{
+				const std::string option{ args[argIdx] };
+				if (option == "--headless")
+				{
+					continue;
+				}
+
+				if (argIdx + 1 >= argc)
+				{
+					std::cerr << "Missing value for " << option << std::endl;
+					return false;
+				}
+				const std::string value{ args[++argIdx] };
+
+				try
+				{
+					if (option == "--scene")		options.sceneName = value;
+					else if (option == "--width")	options.width = std::stoi(value);
+					else if (option == "--height")	options.height = std::stoi(value);
+					else if (option == "--frames")	options.frameCount = std::stoi(value);
+					else if (option == "--threads")	options.threadCount = std::stoi(value);
+					else if (option == "--output")	options.outputPath = value;
+					else if (option == "--sequence")	options.sequencePath = value;
+					else if (option == "--encoders")	options.encoderCount = std::stoi(value);
+					else if (option == "--stream")	options.streamPath = value;
+					else if (option == "--fps")		options.framesPerSecond = std::stoi(value);
+					else if (option == "--strip-height")	options.stripHeight = std::stoi(value);
+					else if (option == "--views")	options.viewCount = std::stoi(value);
+					else if (option == "--crop")
+					{
+						char separators[3]{};
+						std::istringstream stream{ value };
+						stream >> options.cropX >> separators[0] >> options.cropY >> separators[1] >> options.cropWidth >> separators[2] >> options.cropHeight;
+						if (!stream || separators[0] != ',' || separators[1] != ',' || separators[2] != ',')
+							throw std::invalid_argument{ value };
+						options.isCropped = true;
+					}
+					else if (option == "--mesh-cache")
+					{
+						if (value == "on")			options.useMeshCache = true;
+						else if (value == "off")	options.useMeshCache = false;
+						else throw std::invalid_argument{ value };
+					}
+					else if (option == "--mesh-optimize")
+					{
+						if (value == "on")			options.optimizeMeshes = true;
+						else if (value == "off")	options.optimizeMeshes = false;
+						else throw std::invalid_argument{ value };
+					}
+					else if (option == "--compact-vertices")
+					{
+						if (value == "on")			options.useCompactVertices = true;
+						else if (value == "off")	options.useCompactVertices = false;
+						else throw std::invalid_argument{ value };
+					}
+					else if (option == "--stream-format")
+					{
+						if (value == "rgb")			options.streamFormat = StreamFormat::RGB;
+						else if (value == "rgba")	options.streamFormat = StreamFormat::RGBA;
+						else if (value == "y4m")	options.streamFormat = StreamFormat::Y4M;
+						else throw std::invalid_argument{ value };
+					}
+					else
+					{
+						std::cerr << "Unknown option " << option << std::endl;
+						return false;
+					}
+				}
+				catch (const std::exception&)
+				{
+					std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+					return false;
+				}
+			}
+
+			if (options.width <= 0 || options.height <= 0 || options.frameCount <= 0 || options.framesPerSecond <= 0)
+			{
+				std::cerr << "Width, height, frames and fps have to be positive" << std::endl;
+				return false;
+			}
+
+			if (options.isCropped && (options.cropWidth <= 0 || options.cropHeight <= 0 || options.cropX < 0 || options.cropY < 0
+				|| options.cropX + options.cropWidth > options.width || options.cropY + options.cropHeight > options.height))
+			{
+				std::cerr << "Crop window has to lie inside the image" << std::endl;
+				return false;
+			}
+
+			if (options.stripHeight < 0 || (options.stripHeight > 0 && (options.outputPath.empty() || GetImageFormat(options.outputPath) != ImageFormat::PPM
+				|| options.isCropped || options.frameCount > 1 || !options.sequencePath.empty() || !options.streamPath.empty())))
+			{
+				std::cerr << "Strip rendering needs a .ppm --output and a single frame, without --crop, --sequence or --stream" << std::endl;
+				return false;
+			}
+
+			if (options.viewCount < 0 || (options.viewCount > 0 && (options.stripHeight > 0 || options.frameCount > 1
+				|| !options.sequencePath.empty() || !options.streamPath.empty())))
+			{
+				std::cerr << "Batch views need a single frame, without --strip-height, --sequence or --stream" << std::endl;
+				return false;
+			}
+
+			return true;
+		}
+
+		// What the mesh hit tests read per triangle, against float vertices, and the object space floats every mesh keeps next to it.
+		// Meshes shared by instances are counted once, their triangles once per instance
+		void LogMeshMemory(std::ostream& log, const Scene* pScene)
+		{
+			size_t triangleCount{};
+			size_t vertexBytes{};
+			size_t floatVertexBytes{};
+			size_t objectVertexBytes{};
+			std::unordered_set<const TriangleMesh*> countedMeshes{};
+			for (const TriangleMesh& mesh : pScene->GetTriangleMeshGeometries())
+			{
+				const TriangleMesh& geometry{ mesh.GetGeometry() };
+				triangleCount += geometry.GetTriangleCount();
+				if (!countedMeshes.insert(&geometry).second)
+				{
+					continue;
+				}
+
+				vertexBytes += geometry.GetTransformedVertexBytes();
+				floatVertexBytes += geometry.GetTransformedVertexBytes(true);
+				objectVertexBytes += geometry.GetObjectVertexBytes();
+			}
+
+			if (triangleCount > 0)
+			{
+				log << "Meshes: " << triangleCount << " triangles, " << static_cast<double>(vertexBytes) / triangleCount
+					<< " bytes of transformed vertices per triangle (" << static_cast<double>(floatVertexBytes) / triangleCount << " as floats), "
+					<< static_cast<double>(objectVertexBytes) / triangleCount << " bytes of object space vertices" << std::endl;
+			}
+		}
+
+		// Renders the image strip by strip, every finished strip is appended to the output file
+		int RenderStrips(const HeadlessOptions& options, Scene* pScene)
+		{
+			const int stripHeight{ std::min(options.stripHeight, options.height) };
+			const auto pRenderer = new Renderer(options.width, stripHeight);
+			pRenderer->SetThreadCount(options.threadCount);
+
+			StripWriter writer{};
+			if (!writer.Open(options.outputPath, options.width, options.height))
+			{
+				std::cerr << "Could not write " << options.outputPath << std::endl;
+				delete pRenderer;
+				return 1;
+			}
+
+			const int stripCount{ (options.height + stripHeight - 1) / stripHeight };
+			std::cout << options.sceneName << " " << options.width << "x" << options.height << ", " << stripCount << " strip(s) of "
+				<< stripHeight << " rows, " << pRenderer->GetThreadCount() << " thread(s)" << std::endl;
+
+			const auto startTime{ std::chrono::steady_clock::now() };
+			std::vector<uint8_t> rgb{};
+			bool isWritten{ true };
+			for (int stripIdx{}; stripIdx < stripCount && isWritten; ++stripIdx)
+			{
+				// The renderer has a fixed size, the last strip is moved up to fit and skips the rows already written
+				const int firstRow{ stripIdx * stripHeight };
+				const int cropY{ std::min(firstRow, options.height - stripHeight) };
+				pRenderer->SetCropWindow(options.width, options.height, 0, cropY);
+				pRenderer->Render(pScene);
+
+				pRenderer->CopyBufferToRGB(rgb);
+				const int skippedRows{ firstRow - cropY };
+				isWritten = writer.AppendRows(rgb.data() + static_cast<size_t>(skippedRows) * options.width * 3, stripHeight - skippedRows);
+
+				const double elapsedMs{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() };
+				std::cout << "Strip " << stripIdx + 1 << "/" << stripCount << ", " << elapsedMs / 1000.0 << " s" << std::endl;
+			}
+
+			const double totalMs{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() };
+			delete pRenderer;
+
+			if (!writer.Close() || !isWritten)
+			{
+				std::cerr << "Could not write " << options.outputPath << std::endl;
+				return 1;
+			}
+
+			const double primaryRaysPerSecond{ double(options.width) * options.height / (totalMs / 1000.0) };
+			std::cout << "Total " << totalMs << " ms, " << primaryRaysPerSecond / 1'000'000.0 << " M primary rays/s" << std::endl
+				<< "Saved " << options.outputPath << std::endl;
+			return 0;
+		}
+
+		// Cameras on a circle around the point the scene camera looks at, all at the camera's height
+		std::vector<Camera> CreateTurntableCameras(Scene* pScene, int viewCount)
+		{
+			const Camera& sceneCamera{ pScene->GetCamera() };
+
+			HitRecord centerHit{};
+			pScene->GetClosestHit(Ray{ sceneCamera.origin, sceneCamera.forward }, centerHit);
+			const float targetDistance{ centerHit.didHit ? centerHit.t : 10.f };
+			const Vector3 target{ sceneCamera.origin + sceneCamera.forward * targetDistance };
+			const Vector3 targetToCamera{ sceneCamera.origin - target };
+
+			std::vector<Camera> cameras(viewCount, sceneCamera);
+			for (int viewIdx{}; viewIdx < viewCount; ++viewIdx)
+			{
+				// Rotate around the vertical axis through the target
+				const float angle{ viewIdx * 2 * PI / viewCount };
+				const float cosAngle{ std::cos(angle) };
+				const float sinAngle{ std::sin(angle) };
+
+				Camera& camera{ cameras[viewIdx] };
+				camera.origin = target + Vector3{ targetToCamera.x * cosAngle - targetToCamera.z * sinAngle, targetToCamera.y,
+												  targetToCamera.x * sinAngle + targetToCamera.z * cosAngle };
+				camera.forward = (target - camera.origin).Normalized();
+			}
+			return cameras;
+		}
+
+		// Every view of the batch shares the scene, the images are encoded in the background
+		int RenderViews(const HeadlessOptions& options, Scene* pScene, Renderer* pRenderer)
+		{
+			std::vector<Camera> cameras{ CreateTurntableCameras(pScene, options.viewCount) };
+			std::vector<std::vector<ColorRGB>> images{};
+
+			std::cout << options.sceneName << " " << pRenderer->GetWidth() << "x" << pRenderer->GetHeight() << ", "
+				<< options.viewCount << " view(s), " << pRenderer->GetThreadCount() << " thread(s)" << std::endl;
+
+			const auto startTime{ std::chrono::steady_clock::now() };
+			pRenderer->RenderViews(pScene, cameras, images);
+			const double totalMs{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() };
+
+			const double primaryRaysPerSecond{ double(pRenderer->GetWidth()) * pRenderer->GetHeight() * options.viewCount / (totalMs / 1000.0) };
+			std::cout << "Total " << totalMs << " ms, " << totalMs / options.viewCount << " ms per view, "
+				<< primaryRaysPerSecond / 1'000'000.0 << " M primary rays/s" << std::endl;
+
+			if (options.outputPath.empty())
+			{
+				return 0;
+			}
+
+			ImageWriter writer{ options.encoderCount };
+			for (int viewIdx{}; viewIdx < options.viewCount; ++viewIdx)
+			{
+				ImageJob job{ GetNumberedPath(options.outputPath, static_cast<uint32_t>(viewIdx)), GetImageFormat(options.outputPath),
+							  pRenderer->GetWidth(), pRenderer->GetHeight(), writer.AcquireBuffer() };
+				if (job.format == ImageFormat::PFM)
+				{
+					const std::vector<ColorRGB>& image{ images[viewIdx] };
+					job.data.resize(image.size() * sizeof(ColorRGB));
+					std::memcpy(job.data.data(), image.data(), job.data.size());
+				}
+				else
+				{
+					pRenderer->ToneMapToRGB(images[viewIdx], job.data);
+				}
+				writer.Write(std::move(job));
+			}
+			writer.Flush();
+
+			if (writer.GetFailedCount() > 0)
+			{
+				std::cerr << writer.GetFailedCount() << " image(s) could not be written" << std::endl;
+				return 1;
+			}
+			std::cout << "Saved " << writer.GetWrittenCount() << " image(s) as " << GetNumberedPath(options.outputPath, 0) << ", ..." << std::endl;
+			return 0;
+		}
+	}
+
+	int RunHeadless(int argc, char* args[])
+	{
+		for (int argIdx{ 1 }; argIdx < argc; ++argIdx)
+		{
+			const std::string option{ args[argIdx] };
+			if (option == "--help" || option == "-h")
+			{
+				PrintUsage();
+				return 0;
+			}
+		}
+
+		HeadlessOptions options{};
+		if (!ParseOptions(argc, args, options))
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		Scene* pScene{ CreateScene(options.sceneName) };
+		if (!pScene)
+		{
+			std::cerr << "Unknown scene " << options.sceneName << std::endl;
+			PrintUsage();
+			return 1;
+		}
+		pScene->SetUseMeshCache(options.useMeshCache);
+		pScene->SetOptimizeMeshes(options.optimizeMeshes);
+		pScene->SetUseCompactVertices(options.useCompactVertices);
+
+		// Huge images, never a full frame in memory
+		if (options.stripHeight > 0)
+		{
+			const auto pTimer = new Timer();
+			pScene->Initialize();
+
+			// One scene update, same state as the first frame of a normal run
+			pTimer->Start();
+			pTimer->Update();
+			pScene->Update(pTimer);
+
+			const int exitCode{ RenderStrips(options, pScene) };
+			delete pScene;
+			delete pTimer;
+			return exitCode;
+		}
+
+		const auto pTimer = new Timer();
+		// A cropped render only holds the pixels of the window
+		const auto pRenderer = options.isCropped ? new Renderer(options.cropWidth, options.cropHeight) : new Renderer(options.width, options.height);
+		if (options.isCropped)
+		{
+			pRenderer->SetCropWindow(options.width, options.height, options.cropX, options.cropY);
+		}
+		pRenderer->SetThreadCount(options.threadCount);
+
+		// Many cameras, one static scene
+		if (options.viewCount > 0)
+		{
+			pScene->Initialize();
+			pTimer->Start();
+			pTimer->Update();
+			pScene->Update(pTimer);
+
+			const int exitCode{ RenderViews(options, pScene, pRenderer) };
+			delete pScene;
+			delete pRenderer;
+			delete pTimer;
+			return exitCode;
+		}
+
+		// Frames are only copied on the render thread, encoding overlaps with the next frames
+		ImageWriter* pImageWriter{ options.sequencePath.empty() ? nullptr : new ImageWriter(options.encoderCount) };
+
+		// stdout carries the frames when streaming to it
+		std::ostream& log{ options.streamPath == "-" ? std::cerr : std::cout };
+
+		FrameStream* pFrameStream{};
+		if (!options.streamPath.empty())
+		{
+			pFrameStream = new FrameStream();
+			if (!pFrameStream->Open(options.streamPath, options.streamFormat, pRenderer->GetWidth(), pRenderer->GetHeight(), options.framesPerSecond))
+			{
+				std::cerr << "Could not open " << options.streamPath << std::endl;
+				delete pFrameStream;
+				delete pImageWriter;
+				delete pRenderer;
+				delete pTimer;
+				delete pScene;
+				return 1;
+			}
+		}
+
+		pScene->Initialize();
+
+		log << options.sceneName << " " << options.width << "x" << options.height;
+		if (options.isCropped)
+		{
+			log << " (window " << options.cropWidth << "x" << options.cropHeight << " at " << options.cropX << "," << options.cropY << ")";
+		}
+		log
+			<< ", " << options.frameCount << " frame(s), " << pRenderer->GetThreadCount() << " thread(s)" << std::endl;
+		LogMeshMemory(log, pScene);
+
+		double totalMs{};
+		double minMs{ DBL_MAX };
+		double maxMs{};
+
+		pTimer->Start();
+		for (int frameIdx{}; frameIdx < options.frameCount; ++frameIdx)
+		{
+			pTimer->Update();
+			pScene->Update(pTimer);
+
+			// Every frame is traced in full, a batch job wants comparable frames
+			pRenderer->MarkSettingsChanged();
+
+			const auto startTime{ std::chrono::steady_clock::now() };
+			pRenderer->Render(pScene);
+			const double frameMs{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() };
+
+			totalMs += frameMs;
+			minMs = std::min(minMs, frameMs);
+			maxMs = std::max(maxMs, frameMs);
+			log << "Frame " << frameIdx << ": " << frameMs << " ms" << std::endl;
+
+			if (pImageWriter)
+			{
+				pRenderer->SaveBufferToImage(*pImageWriter, GetNumberedPath(options.sequencePath, static_cast<uint32_t>(frameIdx)));
+			}
+			if (pFrameStream)
+			{
+				pRenderer->StreamBuffer(*pFrameStream);
+			}
+		}
+
+		const double averageMs{ totalMs / options.frameCount };
+		const double primaryRaysPerSecond{ double(pRenderer->GetWidth()) * pRenderer->GetHeight() / (averageMs / 1000.0) };
+		log << "Total " << totalMs << " ms, average " << averageMs << " ms (min " << minMs << ", max " << maxMs << "), "
+			<< primaryRaysPerSecond / 1'000'000.0 << " M primary rays/s" << std::endl;
+
+		int exitCode{ 0 };
+		if (pImageWriter)
+		{
+			const auto startTime{ std::chrono::steady_clock::now() };
+			pImageWriter->Flush();
+			const double flushMs{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() };
+
+			log << "Sequence: " << pImageWriter->GetWrittenCount() << " image(s) written, render thread blocked "
+				<< pImageWriter->GetBlockedMs() << " ms on a full queue, " << flushMs << " ms waiting for the last images" << std::endl;
+			if (pImageWriter->GetFailedCount() > 0)
+			{
+				std::cerr << pImageWriter->GetFailedCount() << " image(s) could not be written" << std::endl;
+				exitCode = 1;
+			}
+		}
+
+		if (pFrameStream)
+		{
+			pFrameStream->Close();
+			log << "Stream: " << pFrameStream->GetWrittenCount() << " frame(s) written, render thread blocked "
+				<< pFrameStream->GetBlockedMs() << " ms waiting for the stream" << std::endl;
+			if (pFrameStream->HasFailed())
+			{
+				std::cerr << "Streaming to " << options.streamPath << " failed" << std::endl;
+				exitCode = 1;
+			}
+		}
+
+		if (!options.outputPath.empty())
+		{
+			if (pRenderer->SaveBufferToImage(options.outputPath))
+			{
+				log << "Saved " << options.outputPath << std::endl;
+			}
+			else
+			{
+				std::cerr << "Could not write " << options.outputPath << std::endl;
+				exitCode = 1;
+			}
+		}
+
+		delete pScene;
+		delete pFrameStream;
+		delete pImageWriter;
+		delete pRenderer;
+		delete pTimer;
+
+		return exitCode;
+	}
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace dae
+{
+	/**
+	 * \brief Batch rendering without a window or SDL, prints timing per frame.
+	 *		  RayTracer --headless --scene ReferenceScene_W4 --width 1920 --height 1080 --frames 10 --threads 8 --output frame.png
+	 * \return process exit code
+	 */
+	int RunHeadless(int argc, char* args[]);
+}
@@ -0,0 +1,345 @@
+//Standard includes
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+//Project includes
+#include "ImageWriter.h"
+
+namespace dae {
+
+	namespace
+	{
+		bool WritePPM(const ImageJob& job, std::ofstream& file)
+		{
+			file << "P6\n" << job.width << " " << job.height << "\n255\n";
+			file.write(reinterpret_cast<const char*>(job.data.data()), static_cast<std::streamsize>(job.data.size()));
+			return static_cast<bool>(file);
+		}
+
+		bool WritePFM(const ImageJob& job, std::ofstream& file)
+		{
+			// Negative scale = little endian, rows are stored bottom to top
+			file << "PF\n" << job.width << " " << job.height << "\n-1.0\n";
+
+			const size_t rowSize{ static_cast<size_t>(job.width) * 3 * sizeof(float) };
+			for (int py{ job.height - 1 }; py >= 0; --py)
+			{
+				file.write(reinterpret_cast<const char*>(job.data.data() + py * rowSize), static_cast<std::streamsize>(rowSize));
+			}
+			return static_cast<bool>(file);
+		}
+
+		const std::array<uint32_t, 256>& GetCrcTable()
+		{
+			static const std::array<uint32_t, 256> table{ []
+				{
+					std::array<uint32_t, 256> crcTable{};
+					for (uint32_t idx{}; idx < 256; ++idx)
+					{
+						uint32_t crc{ idx };
+						for (int bit{}; bit < 8; ++bit)
+						{
+							crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+						}
+						crcTable[idx] = crc;
+					}
+					return crcTable;
+				}() };
+			return table;
+		}
+
+		uint32_t UpdateCrc(uint32_t crc, const uint8_t* pData, size_t size)
+		{
+			const std::array<uint32_t, 256>& table{ GetCrcTable() };
+			for (size_t idx{}; idx < size; ++idx)
+			{
+				crc = table[(crc ^ pData[idx]) & 0xFF] ^ (crc >> 8);
+			}
+			return crc;
+		}
+
+		void AppendBigEndian(std::vector<uint8_t>& bytes, uint32_t value)
+		{
+			bytes.push_back(static_cast<uint8_t>(value >> 24));
+			bytes.push_back(static_cast<uint8_t>(value >> 16));
+			bytes.push_back(static_cast<uint8_t>(value >> 8));
+			bytes.push_back(static_cast<uint8_t>(value));
+		}
+
+		void WritePNGChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+		{
+			std::vector<uint8_t> header{};
+			AppendBigEndian(header, static_cast<uint32_t>(data.size()));
+			header.insert(header.end(), type, type + 4);
+
+			uint32_t crc{ UpdateCrc(0xFFFFFFFFu, header.data() + 4, 4) };
+			crc = UpdateCrc(crc, data.data(), data.size()) ^ 0xFFFFFFFFu;
+
+			std::vector<uint8_t> footer{};
+			AppendBigEndian(footer, crc);
+
+			file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+			file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+			file.write(reinterpret_cast<const char*>(footer.data()), static_cast<std::streamsize>(footer.size()));
+		}
+
+		bool WritePNG(const ImageJob& job, std::ofstream& file)
+		{
+			static constexpr uint8_t signature[]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+			file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+			// Width, height, 8 bit, truecolor, deflate, adaptive filtering, no interlace
+			std::vector<uint8_t> header{};
+			AppendBigEndian(header, static_cast<uint32_t>(job.width));
+			AppendBigEndian(header, static_cast<uint32_t>(job.height));
+			header.insert(header.end(), { 8, 2, 0, 0, 0 });
+			WritePNGChunk(file, "IHDR", header);
+
+			// Scanlines with filter type 0, stored in zlib blocks of at most 65535 bytes (no compression, encoding stays cheap)
+			const size_t rowSize{ static_cast<size_t>(job.width) * 3 };
+			const size_t rawSize{ (rowSize + 1) * job.height };
+			constexpr size_t maxBlockSize{ 65535 };
+
+			std::vector<uint8_t> raw(rawSize);
+			for (int py{}; py < job.height; ++py)
+			{
+				uint8_t* pRow{ raw.data() + py * (rowSize + 1) };
+				pRow[0] = 0;
+				std::memcpy(pRow + 1, job.data.data() + py * rowSize, rowSize);
+			}
+
+			std::vector<uint8_t> compressed{};
+			compressed.reserve(rawSize + (rawSize / maxBlockSize + 1) * 5 + 6);
+			compressed.push_back(0x78);
+			compressed.push_back(0x01);
+
+			uint32_t adlerA{ 1 };
+			uint32_t adlerB{ 0 };
+			for (size_t offset{}; offset < rawSize; offset += maxBlockSize)
+			{
+				const size_t blockSize{ std::min(maxBlockSize, rawSize - offset) };
+				const bool isLast{ offset + blockSize >= rawSize };
+
+				compressed.push_back(isLast ? 1 : 0);
+				compressed.push_back(static_cast<uint8_t>(blockSize));
+				compressed.push_back(static_cast<uint8_t>(blockSize >> 8));
+				compressed.push_back(static_cast<uint8_t>(~blockSize));
+				compressed.push_back(static_cast<uint8_t>(~blockSize >> 8));
+				compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+
+				// Adler-32 of the uncompressed bytes
+				for (size_t idx{ offset }; idx < offset + blockSize; ++idx)
+				{
+					adlerA = (adlerA + raw[idx]) % 65521;
+					adlerB = (adlerB + adlerA) % 65521;
+				}
+			}
+			AppendBigEndian(compressed, (adlerB << 16) | adlerA);
+
+			WritePNGChunk(file, "IDAT", compressed);
+			WritePNGChunk(file, "IEND", {});
+			return static_cast<bool>(file);
+		}
+	}
+
+	ImageFormat GetImageFormat(const std::string& path)
+	{
+		const size_t dotIdx{ path.find_last_of('.') };
+		if (dotIdx == std::string::npos)
+		{
+			return ImageFormat::PPM;
+		}
+
+		std::string extension{ path.substr(dotIdx + 1) };
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		if (extension == "png")
+			return ImageFormat::PNG;
+		if (extension == "pfm")
+			return ImageFormat::PFM;
+		return ImageFormat::PPM;
+	}
+
+	std::string GetNumberedPath(const std::string& path, uint32_t number)
+	{
+		std::string digits{ std::to_string(number) };
+		if (digits.size() < 4)
+		{
+			digits.insert(0, 4 - digits.size(), '0');
+		}
+
+		// Only a dot after the last separator starts the extension
+		const size_t dotIdx{ path.find_last_of('.') };
+		const size_t separatorIdx{ path.find_last_of("/\\") };
+		if (dotIdx == std::string::npos || (separatorIdx != std::string::npos && dotIdx < separatorIdx))
+		{
+			return path + "_" + digits;
+		}
+		return path.substr(0, dotIdx) + "_" + digits + path.substr(dotIdx);
+	}
+
+	ImageWriter::ImageWriter(int threadCount, size_t maxQueuedImages)
+		: m_MaxQueuedImages{ std::max<size_t>(maxQueuedImages, 1) }
+	{
+		threadCount = std::max(threadCount, 1);
+		for (int threadIdx{}; threadIdx < threadCount; ++threadIdx)
+		{
+			m_Threads.emplace_back(&ImageWriter::EncodeLoop, this);
+		}
+	}
+
+	ImageWriter::~ImageWriter()
+	{
+		// Everything that was queued still gets written
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_JobAdded.notify_all();
+
+		for (std::thread& thread : m_Threads)
+		{
+			thread.join();
+		}
+	}
+
+	std::vector<uint8_t> ImageWriter::AcquireBuffer()
+	{
+		std::lock_guard lock{ m_Mutex };
+		if (m_FreeBuffers.empty())
+		{
+			return {};
+		}
+
+		std::vector<uint8_t> buffer{ std::move(m_FreeBuffers.back()) };
+		m_FreeBuffers.pop_back();
+		return buffer;
+	}
+
+	void ImageWriter::Write(ImageJob&& job)
+	{
+		std::unique_lock lock{ m_Mutex };
+		if (m_Jobs.size() >= m_MaxQueuedImages)
+		{
+			const auto startTime{ std::chrono::steady_clock::now() };
+			m_JobTaken.wait(lock, [this] { return m_Jobs.size() < m_MaxQueuedImages; });
+			m_BlockedMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		}
+
+		m_Jobs.push_back(std::move(job));
+		lock.unlock();
+		m_JobAdded.notify_one();
+	}
+
+	void ImageWriter::Flush()
+	{
+		std::unique_lock lock{ m_Mutex };
+		m_JobDone.wait(lock, [this] { return m_Jobs.empty() && m_BusyCount == 0; });
+	}
+
+	uint32_t ImageWriter::GetWrittenCount() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_WrittenCount;
+	}
+
+	uint32_t ImageWriter::GetFailedCount() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_FailedCount;
+	}
+
+	double ImageWriter::GetBlockedMs() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_BlockedMs;
+	}
+
+	bool ImageWriter::Encode(const ImageJob& job)
+	{
+		const size_t channelSize{ job.format == ImageFormat::PFM ? sizeof(float) : 1 };
+		if (job.width <= 0 || job.height <= 0 || job.data.size() != static_cast<size_t>(job.width) * job.height * 3 * channelSize)
+		{
+			return false;
+		}
+
+		std::ofstream file{ job.path, std::ios::binary };
+		if (!file)
+		{
+			return false;
+		}
+
+		switch (job.format)
+		{
+		case ImageFormat::PNG:
+			return WritePNG(job, file);
+		case ImageFormat::PFM:
+			return WritePFM(job, file);
+		default:
+			return WritePPM(job, file);
+		}
+	}
+
+	bool StripWriter::Open(const std::string& path, int width, int height)
+	{
+		m_File.open(path, std::ios::binary);
+		m_Width = width;
+		m_Height = height;
+		m_WrittenRowCount = 0;
+
+		m_File << "P6\n" << width << " " << height << "\n255\n";
+		return static_cast<bool>(m_File);
+	}
+
+	bool StripWriter::AppendRows(const uint8_t* pRGB, int rowCount)
+	{
+		if (m_WrittenRowCount + rowCount > m_Height)
+		{
+			return false;
+		}
+
+		m_File.write(reinterpret_cast<const char*>(pRGB), static_cast<std::streamsize>(m_Width) * rowCount * 3);
+		m_WrittenRowCount += rowCount;
+		return static_cast<bool>(m_File);
+	}
+
+	bool StripWriter::Close()
+	{
+		m_File.close();
+		return !m_File.fail() && m_WrittenRowCount == m_Height;
+	}
+
+	void ImageWriter::EncodeLoop()
+	{
+		std::unique_lock lock{ m_Mutex };
+		while (true)
+		{
+			m_JobAdded.wait(lock, [this] { return m_IsStopping || !m_Jobs.empty(); });
+			if (m_Jobs.empty())
+			{
+				return;
+			}
+
+			ImageJob job{ std::move(m_Jobs.front()) };
+			m_Jobs.pop_front();
+			++m_BusyCount;
+			lock.unlock();
+			m_JobTaken.notify_one();
+
+			const bool isWritten{ Encode(job) };
+
+			lock.lock();
+			--m_BusyCount;
+			++(isWritten ? m_WrittenCount : m_FailedCount);
+			if (m_FreeBuffers.size() < m_MaxQueuedImages)
+			{
+				m_FreeBuffers.push_back(std::move(job.data));
+			}
+			m_JobDone.notify_all();
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	enum class ImageFormat
+	{
+		PPM,	// Binary 8 bit RGB
+		PNG,	// 8 bit RGB, stored (uncompressed) deflate blocks
+		PFM		// 32 bit float RGB, linear colors before tone mapping
+	};
+
+	// Picks the format from the extension of the path (.png, .pfm, anything else is PPM)
+	ImageFormat GetImageFormat(const std::string& path);
+	// "frames/shot.png", 12 -> "frames/shot_0012.png"
+	std::string GetNumberedPath(const std::string& path, uint32_t number);
+
+	// One image waiting to be encoded. PFM data is width * height * 3 floats, the others 8 bit RGB
+	struct ImageJob
+	{
+		std::string path{};
+		ImageFormat format{ ImageFormat::PPM };
+		int width{};
+		int height{};
+		std::vector<uint8_t> data{};
+	};
+
+	//Encodes and writes images on background threads, so saving never stalls rendering for longer than a copy
+	class ImageWriter final
+	{
+	public:
+		ImageWriter(int threadCount = 2, size_t maxQueuedImages = 8);
+		~ImageWriter();
+
+		ImageWriter(const ImageWriter&) = delete;
+		ImageWriter(ImageWriter&&) noexcept = delete;
+		ImageWriter& operator=(const ImageWriter&) = delete;
+		ImageWriter& operator=(ImageWriter&&) noexcept = delete;
+
+		// Buffer of an already written image when there is one, saves an allocation per frame
+		std::vector<uint8_t> AcquireBuffer();
+		// Queues the image, blocks while maxQueuedImages are still waiting (back-pressure)
+		void Write(ImageJob&& job);
+		// Blocks until everything queued so far is on disk
+		void Flush();
+
+		uint32_t GetWrittenCount() const;
+		uint32_t GetFailedCount() const;
+		// Time Write spent waiting for a free slot
+		double GetBlockedMs() const;
+
+		// Synchronous, true on success
+		static bool Encode(const ImageJob& job);
+
+	private:
+		size_t m_MaxQueuedImages{};
+		std::vector<std::thread> m_Threads{};
+
+		mutable std::mutex m_Mutex{};
+		std::condition_variable m_JobAdded{};
+		std::condition_variable m_JobTaken{};
+		std::condition_variable m_JobDone{};
+
+		std::deque<ImageJob> m_Jobs{};
+		std::vector<std::vector<uint8_t>> m_FreeBuffers{};
+		size_t m_BusyCount{};
+		bool m_IsStopping{ false };
+
+		uint32_t m_WrittenCount{};
+		uint32_t m_FailedCount{};
+		double m_BlockedMs{};
+
+		void EncodeLoop();
+	};
+
+	//Binary PPM written top to bottom a few rows at a time, the image never has to fit in memory
+	class StripWriter final
+	{
+	public:
+		StripWriter() = default;
+		~StripWriter() = default;
+
+		StripWriter(const StripWriter&) = delete;
+		StripWriter(StripWriter&&) noexcept = delete;
+		StripWriter& operator=(const StripWriter&) = delete;
+		StripWriter& operator=(StripWriter&&) noexcept = delete;
+
+		// Writes the header, false when the file can't be created
+		bool Open(const std::string& path, int width, int height);
+		// rowCount rows of 8 bit RGB, following the rows written before
+		bool AppendRows(const uint8_t* pRGB, int rowCount);
+		// True when every row was written
+		bool Close();
+
+		int GetWrittenRowCount() const { return m_WrittenRowCount; }
+
+	private:
+		std::ofstream m_File{};
+		int m_Width{};
+		int m_Height{};
+		int m_WrittenRowCount{};
+	};
+}
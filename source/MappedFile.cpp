@@ -0,0 +1,130 @@
+//Standard includes
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Project includes
+#include "MappedFile.h"
+
+namespace dae {
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+
+		const HANDLE file{ CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file, &size))
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		m_FileHandle = file;
+		m_Size = static_cast<size_t>(size.QuadPart);
+		m_IsOpen = true;
+
+		// Mapping an empty file fails, there is nothing to read anyway
+		if (m_Size == 0)
+		{
+			return true;
+		}
+
+		m_MappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_MappingHandle)
+		{
+			m_pData = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+		}
+
+		if (!m_pData)
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_pData)
+			UnmapViewOfFile(m_pData);
+		if (m_MappingHandle)
+			CloseHandle(m_MappingHandle);
+		if (m_FileHandle)
+			CloseHandle(m_FileHandle);
+
+		m_pData = nullptr;
+		m_MappingHandle = nullptr;
+		m_FileHandle = nullptr;
+		m_Size = 0;
+		m_IsOpen = false;
+	}
+#else
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+
+		const int file{ open(path.c_str(), O_RDONLY) };
+		if (file == -1)
+		{
+			return false;
+		}
+
+		struct stat status {};
+		if (fstat(file, &status) != 0)
+		{
+			close(file);
+			return false;
+		}
+
+		m_Size = static_cast<size_t>(status.st_size);
+		if (m_Size > 0)
+		{
+			void* pData{ mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0) };
+			if (pData == MAP_FAILED)
+			{
+				close(file);
+				m_Size = 0;
+				return false;
+			}
+
+			// Parsers read front to back
+			madvise(pData, m_Size, MADV_SEQUENTIAL);
+			m_pData = static_cast<const char*>(pData);
+		}
+
+		// The mapping stays valid without the descriptor
+		close(file);
+		m_IsOpen = true;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_pData)
+			munmap(const_cast<char*>(m_pData), m_Size);
+
+		m_pData = nullptr;
+		m_Size = 0;
+		m_IsOpen = false;
+	}
+#endif
+}
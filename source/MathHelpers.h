@@ -1,5 +1,7 @@
 #pragma once
+#include <cfloat>
 #include <cmath>
+#include <cstdint>
 
 namespace dae
 {
@@ -23,6 +25,28 @@ namespace dae
 		return ((1 - factor) * a) + (factor * b);
 	}
 
+	// Radical inverse of index in the given base (low-discrepancy sequence in [0,1[)
+	inline float Halton(uint32_t index, uint32_t base)
+	{
+		float result{ 0.f };
+		float fraction{ 1.f / base };
+
+		while (index > 0)
+		{
+			result += (index % base) * fraction;
+			index /= base;
+			fraction /= base;
+		}
+
+		return result;
+	}
+
+	// Mixes value into seed (boost::hash_combine, 64 bit)
+	inline uint64_t HashCombine(uint64_t seed, uint64_t value)
+	{
+		return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+	}
+
 	inline bool AreEqual(float a, float b, float epsilon = FLT_EPSILON)
 	{
 		return abs(a - b) < epsilon;
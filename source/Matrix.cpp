@@ -82,6 +82,34 @@ namespace dae {
 		return out;
 	}
 
+	Matrix Matrix::Inverse(const Matrix& m)
+	{
+		// Rows of the inverse 3x3 from the cross products of the axes (cofactors over the determinant)
+		const Vector3 xAxis{ m.GetAxisX() };
+		const Vector3 yAxis{ m.GetAxisY() };
+		const Vector3 zAxis{ m.GetAxisZ() };
+
+		const Vector3 yz{ Vector3::Cross(yAxis, zAxis) };
+		const Vector3 zx{ Vector3::Cross(zAxis, xAxis) };
+		const Vector3 xy{ Vector3::Cross(xAxis, yAxis) };
+
+		const float determinant{ Vector3::Dot(xAxis, yz) };
+		assert(determinant != 0.f && "Matrix can't be inverted");
+		const float inverseDeterminant{ 1.f / determinant };
+
+		Matrix out{
+			Vector3{ yz.x, zx.x, xy.x } * inverseDeterminant,
+			Vector3{ yz.y, zx.y, xy.y } * inverseDeterminant,
+			Vector3{ yz.z, zx.z, xy.z } * inverseDeterminant,
+			Vector3{}
+		};
+
+		// Undo the translation after the 3x3
+		out[3] = { -out.TransformVector(m.GetTranslation()), 1 };
+
+		return out;
+	}
+
 	Vector3 Matrix::GetAxisX() const
 	{
 		return data[0];
@@ -0,0 +1,198 @@
+//Standard includes
+#include <algorithm>
+
+//Project includes
+#include "MeshBVH.h"
+
+namespace dae {
+
+	namespace
+	{
+		constexpr int g_BinCount{ 16 };
+		// SAH can split off a few triangles at a time, below this depth every split is at the median so traversal stacks stay small
+		constexpr int g_MaxSAHDepth{ 40 };
+
+		struct Bounds
+		{
+			Vector3 minAABB{ FLT_MAX, FLT_MAX, FLT_MAX };
+			Vector3 maxAABB{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+			void Grow(const Vector3& point)
+			{
+				minAABB = Vector3::Min(minAABB, point);
+				maxAABB = Vector3::Max(maxAABB, point);
+			}
+
+			void Grow(const Bounds& bounds)
+			{
+				minAABB = Vector3::Min(minAABB, bounds.minAABB);
+				maxAABB = Vector3::Max(maxAABB, bounds.maxAABB);
+			}
+
+			float GetHalfArea() const
+			{
+				if (minAABB.x > maxAABB.x)
+					return 0.f;
+
+				const Vector3 extent{ maxAABB - minAABB };
+				return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+			}
+		};
+
+		struct BuildContext
+		{
+			TriangleMesh& mesh;
+			uint32_t maxLeafSize{};
+			std::vector<Bounds> triangleBounds{};
+			std::vector<Vector3> centroids{};
+		};
+
+		void Subdivide(BuildContext& context, uint32_t nodeIdx, uint32_t first, uint32_t count, int depth)
+		{
+			std::vector<uint32_t>& triangles{ context.mesh.bvhTriangles };
+
+			Bounds bounds{};
+			Bounds centroidBounds{};
+			for (uint32_t idx{ first }; idx < first + count; ++idx)
+			{
+				bounds.Grow(context.triangleBounds[triangles[idx]]);
+				centroidBounds.Grow(context.centroids[triangles[idx]]);
+			}
+
+			BVHNode& node{ context.mesh.bvhNodes[nodeIdx] };
+			node.minAABB = bounds.minAABB;
+			node.maxAABB = bounds.maxAABB;
+
+			if (count <= context.maxLeafSize)
+			{
+				node.firstIdx = first;
+				node.triangleCount = count;
+				return;
+			}
+
+			// Cheapest split between bins of the centroids, on every axis
+			int bestAxis{ -1 };
+			int bestBin{};
+			float bestCost{ FLT_MAX };
+			for (int axis{}; axis < 3 && depth < g_MaxSAHDepth; ++axis)
+			{
+				const float extent{ centroidBounds.maxAABB[axis] - centroidBounds.minAABB[axis] };
+				if (extent <= 0.f)
+					continue;
+
+				Bounds binBounds[g_BinCount]{};
+				uint32_t binCounts[g_BinCount]{};
+				const float binScale{ g_BinCount / extent };
+				for (uint32_t idx{ first }; idx < first + count; ++idx)
+				{
+					const uint32_t triangleIdx{ triangles[idx] };
+					const int bin{ std::min(static_cast<int>((context.centroids[triangleIdx][axis] - centroidBounds.minAABB[axis]) * binScale), g_BinCount - 1) };
+					binBounds[bin].Grow(context.triangleBounds[triangleIdx]);
+					++binCounts[bin];
+				}
+
+				// Right side first, then sweep the left side through the same splits
+				float rightCosts[g_BinCount]{};
+				Bounds rightBounds{};
+				uint32_t rightCount{};
+				for (int bin{ g_BinCount - 1 }; bin > 0; --bin)
+				{
+					rightBounds.Grow(binBounds[bin]);
+					rightCount += binCounts[bin];
+					rightCosts[bin - 1] = rightCount * rightBounds.GetHalfArea();
+				}
+
+				Bounds leftBounds{};
+				uint32_t leftCount{};
+				for (int bin{}; bin < g_BinCount - 1; ++bin)
+				{
+					leftBounds.Grow(binBounds[bin]);
+					leftCount += binCounts[bin];
+
+					const float cost{ leftCount * leftBounds.GetHalfArea() + rightCosts[bin] };
+					if (leftCount > 0 && leftCount < count && cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = bin;
+					}
+				}
+			}
+
+			uint32_t* pFirst{ triangles.data() + first };
+			uint32_t* pLast{ pFirst + count };
+			uint32_t* pMid{};
+			if (bestAxis != -1)
+			{
+				const float binScale{ g_BinCount / (centroidBounds.maxAABB[bestAxis] - centroidBounds.minAABB[bestAxis]) };
+				pMid = std::partition(pFirst, pLast, [&](uint32_t triangleIdx)
+					{
+						const int bin{ std::min(static_cast<int>((context.centroids[triangleIdx][bestAxis] - centroidBounds.minAABB[bestAxis]) * binScale), g_BinCount - 1) };
+						return bin <= bestBin;
+					});
+			}
+
+			// Too deep or all centroids in one point: halve along the longest axis
+			if (pMid == nullptr || pMid == pFirst || pMid == pLast)
+			{
+				const Vector3 extent{ centroidBounds.maxAABB - centroidBounds.minAABB };
+				const int axis{ extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2) };
+
+				pMid = pFirst + count / 2;
+				std::nth_element(pFirst, pMid, pLast, [&](uint32_t lhs, uint32_t rhs)
+					{
+						return context.centroids[lhs][axis] < context.centroids[rhs][axis];
+					});
+			}
+
+			// Reserved up front, node stays valid
+			const uint32_t childIdx{ static_cast<uint32_t>(context.mesh.bvhNodes.size()) };
+			context.mesh.bvhNodes.emplace_back();
+			context.mesh.bvhNodes.emplace_back();
+			node.firstIdx = childIdx;
+			node.triangleCount = 0;
+
+			const uint32_t leftCount{ static_cast<uint32_t>(pMid - pFirst) };
+			Subdivide(context, childIdx, first, leftCount, depth + 1);
+			Subdivide(context, childIdx + 1, first + leftCount, count - leftCount, depth + 1);
+		}
+	}
+
+	void MeshBVH::Build(TriangleMesh& mesh, uint32_t maxLeafSize)
+	{
+		const uint32_t triangleCount{ static_cast<uint32_t>(mesh.GetTriangleCount()) };
+
+		mesh.bvhNodes.clear();
+		mesh.bvhTriangles.clear();
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		BuildContext context{ mesh, std::max(maxLeafSize, 1u) };
+		context.triangleBounds.resize(triangleCount);
+		context.centroids.resize(triangleCount);
+		for (uint32_t triangleIdx{}; triangleIdx < triangleCount; ++triangleIdx)
+		{
+			Bounds& bounds{ context.triangleBounds[triangleIdx] };
+			for (uint32_t corner{}; corner < 3; ++corner)
+			{
+				bounds.Grow(mesh.positions[mesh.GetIndex(size_t{ triangleIdx } * 3 + corner)]);
+			}
+			context.centroids[triangleIdx] = (bounds.minAABB + bounds.maxAABB) * 0.5f;
+		}
+
+		mesh.bvhTriangles.resize(triangleCount);
+		for (uint32_t triangleIdx{}; triangleIdx < triangleCount; ++triangleIdx)
+		{
+			mesh.bvhTriangles[triangleIdx] = triangleIdx;
+		}
+
+		// A binary tree with at least one triangle per leaf
+		mesh.bvhNodes.reserve(triangleCount * 2 - 1);
+		mesh.bvhNodes.emplace_back();
+		Subdivide(context, 0, 0, triangleCount, 0);
+
+		mesh.RefitBVH();
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "DataTypes.h"
+
+namespace dae
+{
+	namespace MeshBVH
+	{
+		// Binned SAH over the triangle centroids of mesh.positions, fills mesh.bvhNodes and mesh.bvhTriangles.
+		// Refits to the transformed positions when the mesh already has them
+		void Build(TriangleMesh& mesh, uint32_t maxLeafSize = 4);
+	}
+}
@@ -0,0 +1,268 @@
+//Standard includes
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+//Project includes
+#include "MeshCache.h"
+#include "MappedFile.h"
+
+namespace dae {
+
+	namespace
+	{
+		constexpr char g_Magic[8]{ 'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0' };
+		// Reads back differently on a big endian machine
+		constexpr uint32_t g_ByteOrderMark{ 0x01020304 };
+		constexpr size_t g_Alignment{ 16 };
+		// Files of version 1 before this flag existed have 0 there, they were never optimized
+		constexpr uint32_t g_OptimizedFlag{ 1 };
+
+		// Traversal stack of HitTest_TriangleMeshBVH holds 96 nodes, MeshBVH::Build stays far below this
+		constexpr uint32_t g_MaxNodeDepth{ 90 };
+
+		static_assert(sizeof(Vector3) == 12, "Cache stores Vector3 as 3 packed floats");
+		static_assert(sizeof(BVHNode) == 32, "Cache stores BVHNode as 32 bytes");
+
+		struct CacheHeader
+		{
+			char magic[8]{};
+			uint32_t version{};
+			uint32_t byteOrderMark{};
+			uint64_t sourceHash{};
+
+			uint32_t positionCount{};
+			uint32_t normalCount{};
+			uint32_t indexCount{};
+			uint32_t nodeCount{};
+			uint32_t bvhTriangleCount{};
+			uint32_t flags{};
+		};
+
+		enum CacheSection
+		{
+			Positions,
+			Normals,
+			Indices,
+			Nodes,
+			BVHTriangles,
+			SectionCount
+		};
+
+		size_t AlignUp(size_t offset)
+		{
+			return (offset + g_Alignment - 1) / g_Alignment * g_Alignment;
+		}
+
+		// Offset of every section and the size of the whole file
+		size_t GetLayout(const CacheHeader& header, size_t (&offsets)[SectionCount], size_t (&sizes)[SectionCount])
+		{
+			sizes[Positions] = size_t{ header.positionCount } * sizeof(Vector3);
+			sizes[Normals] = size_t{ header.normalCount } * sizeof(Vector3);
+			sizes[Indices] = size_t{ header.indexCount } * sizeof(int);
+			sizes[Nodes] = size_t{ header.nodeCount } * sizeof(BVHNode);
+			sizes[BVHTriangles] = size_t{ header.bvhTriangleCount } * sizeof(uint32_t);
+
+			size_t offset{ AlignUp(sizeof(CacheHeader)) };
+			for (int section{}; section < SectionCount; ++section)
+			{
+				offsets[section] = offset;
+				offset = AlignUp(offset + sizes[section]);
+			}
+			return offset;
+		}
+
+		template<typename T>
+		void CopySection(const char* pData, size_t offset, uint32_t count, std::vector<T>& target)
+		{
+			target.resize(count);
+			if (count > 0)
+				std::memcpy(target.data(), pData + offset, size_t{ count } * sizeof(T));
+		}
+
+		// A damaged or hand edited file must not make the hit tests read out of bounds, one pass over every array
+		bool HasValidRanges(const TriangleMesh& mesh)
+		{
+			for (const int vertexIdx : mesh.indices)
+			{
+				if (vertexIdx < 0 || static_cast<size_t>(vertexIdx) >= mesh.positions.size())
+					return false;
+			}
+
+			const size_t triangleCount{ mesh.indices.size() / 3 };
+			for (const uint32_t triangleIdx : mesh.bvhTriangles)
+			{
+				if (triangleIdx >= triangleCount)
+					return false;
+			}
+
+			// Children always come after their parent, so one pass also finds every depth and no node can loop back
+			std::vector<uint8_t> depths(mesh.bvhNodes.size());
+			for (size_t nodeIdx{}; nodeIdx < mesh.bvhNodes.size(); ++nodeIdx)
+			{
+				const BVHNode& node{ mesh.bvhNodes[nodeIdx] };
+				if (node.triangleCount > 0)
+				{
+					if (uint64_t{ node.firstIdx } + node.triangleCount > mesh.bvhTriangles.size())
+						return false;
+					continue;
+				}
+
+				if (node.firstIdx <= nodeIdx || uint64_t{ node.firstIdx } + 1 >= mesh.bvhNodes.size() || depths[nodeIdx] >= g_MaxNodeDepth)
+					return false;
+				// Deepest path when a broken file gives a node two parents
+				const uint8_t childDepth{ static_cast<uint8_t>(depths[nodeIdx] + 1) };
+				depths[node.firstIdx] = std::max(depths[node.firstIdx], childDepth);
+				depths[node.firstIdx + 1] = std::max(depths[node.firstIdx + 1], childDepth);
+			}
+			return true;
+		}
+	}
+
+	std::string MeshCache::GetCachePath(const std::string& sourcePath)
+	{
+		return sourcePath + ".rtmesh";
+	}
+
+	bool MeshCache::HashFile(const std::string& path, uint64_t& hash)
+	{
+		MappedFile file{};
+		if (!file.Open(path))
+			return false;
+
+		const char* pData{ file.GetData() };
+		const size_t size{ file.GetSize() };
+
+		// 8 bytes per multiply, far faster than the disk
+		constexpr uint64_t prime{ 0x9E3779B97F4A7C15ull };
+		hash = 0xCBF29CE484222325ull ^ size;
+
+		size_t offset{};
+		for (; offset + 8 <= size; offset += 8)
+		{
+			uint64_t word{};
+			std::memcpy(&word, pData + offset, 8);
+			hash = (hash ^ word) * prime;
+			hash ^= hash >> 32;
+		}
+
+		uint64_t tail{};
+		if (offset < size)
+			std::memcpy(&tail, pData + offset, size - offset);
+		hash = (hash ^ tail) * prime;
+		hash ^= hash >> 29;
+		return true;
+	}
+
+	bool MeshCache::Load(const std::string& cachePath, uint64_t sourceHash, bool isOptimized, TriangleMesh& mesh, size_t* pByteCount)
+	{
+		MappedFile file{};
+		if (!file.Open(cachePath) || file.GetSize() < sizeof(CacheHeader))
+			return false;
+
+		CacheHeader header{};
+		std::memcpy(&header, file.GetData(), sizeof(CacheHeader));
+		if (std::memcmp(header.magic, g_Magic, sizeof(g_Magic)) != 0 || header.version != g_Version
+			|| header.byteOrderMark != g_ByteOrderMark || header.sourceHash != sourceHash || header.flags != (isOptimized ? g_OptimizedFlag : 0))
+		{
+			return false;
+		}
+
+		size_t offsets[SectionCount]{};
+		size_t sizes[SectionCount]{};
+		if (GetLayout(header, offsets, sizes) != file.GetSize() || header.indexCount % 3 != 0
+			|| header.normalCount != header.indexCount / 3 || header.bvhTriangleCount != header.indexCount / 3)
+		{
+			return false;
+		}
+
+		const char* pData{ file.GetData() };
+		CopySection(pData, offsets[Positions], header.positionCount, mesh.positions);
+		CopySection(pData, offsets[Normals], header.normalCount, mesh.normals);
+		CopySection(pData, offsets[Indices], header.indexCount, mesh.indices);
+		mesh.compactIndices.clear();
+		CopySection(pData, offsets[Nodes], header.nodeCount, mesh.bvhNodes);
+		CopySection(pData, offsets[BVHTriangles], header.bvhTriangleCount, mesh.bvhTriangles);
+
+		if (!HasValidRanges(mesh))
+		{
+			// The caller parses the source file into the same mesh
+			mesh.positions.clear();
+			mesh.normals.clear();
+			mesh.indices.clear();
+			mesh.bvhNodes.clear();
+			mesh.bvhTriangles.clear();
+			return false;
+		}
+
+		if (pByteCount)
+			*pByteCount = file.GetSize();
+		return true;
+	}
+
+	bool MeshCache::Save(const std::string& cachePath, uint64_t sourceHash, bool isOptimized, const TriangleMesh& mesh)
+	{
+		CacheHeader header{};
+		std::memcpy(header.magic, g_Magic, sizeof(g_Magic));
+		header.version = g_Version;
+		header.byteOrderMark = g_ByteOrderMark;
+		header.sourceHash = sourceHash;
+		header.flags = isOptimized ? g_OptimizedFlag : 0;
+		header.positionCount = static_cast<uint32_t>(mesh.positions.size());
+		header.normalCount = static_cast<uint32_t>(mesh.normals.size());
+		header.indexCount = static_cast<uint32_t>(mesh.GetIndexCount());
+		header.nodeCount = static_cast<uint32_t>(mesh.bvhNodes.size());
+		header.bvhTriangleCount = static_cast<uint32_t>(mesh.bvhTriangles.size());
+
+		size_t offsets[SectionCount]{};
+		size_t sizes[SectionCount]{};
+		const size_t fileSize{ GetLayout(header, offsets, sizes) };
+
+		// The file always holds int indices, 16 bit ones are widened for the write
+		std::vector<int> wideIndices{};
+		if (!mesh.compactIndices.empty())
+			wideIndices.assign(mesh.compactIndices.begin(), mesh.compactIndices.end());
+		const std::vector<int>& indices{ mesh.compactIndices.empty() ? mesh.indices : wideIndices };
+
+		const char* sectionData[SectionCount]{ reinterpret_cast<const char*>(mesh.positions.data()), reinterpret_cast<const char*>(mesh.normals.data()),
+			reinterpret_cast<const char*>(indices.data()), reinterpret_cast<const char*>(mesh.bvhNodes.data()),
+			reinterpret_cast<const char*>(mesh.bvhTriangles.data()) };
+
+		// Node bounds may already be in world space, that's fine: UpdateTransforms refits them after Load
+		const std::string tempPath{ cachePath + ".tmp" };
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!file)
+				return false;
+
+			const char padding[g_Alignment]{};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+			size_t offset{ sizeof(CacheHeader) };
+			for (int section{}; section < SectionCount; ++section)
+			{
+				file.write(padding, offsets[section] - offset);
+				file.write(sectionData[section], sizes[section]);
+				offset = offsets[section] + sizes[section];
+			}
+			file.write(padding, fileSize - offset);
+
+			if (!file)
+			{
+				file.close();
+				std::error_code error{};
+				std::filesystem::remove(tempPath, error);
+				return false;
+			}
+		}
+
+		std::error_code error{};
+		std::filesystem::rename(tempPath, cachePath, error);
+		if (error)
+		{
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	// Binary copy of a loaded mesh next to its source file ("bunny.obj" -> "bunny.obj.rtmesh").
+	// Header, then positions, normals, indices, BVH nodes and BVH triangles, each 16 byte aligned and little endian.
+	// Nothing in it is a pointer, loading maps the file and copies every array in one go.
+	namespace MeshCache
+	{
+		// Bump whenever the layout of the file or of BVHNode changes
+		constexpr uint32_t g_Version{ 1 };
+
+		std::string GetCachePath(const std::string& sourcePath);
+
+		// 64 bit hash of the file contents, false when the file can't be read
+		bool HashFile(const std::string& path, uint64_t& hash);
+
+		// False when there's no cache, it's from another version or another source file,
+		// or isOptimized doesn't match what was written (MeshOptimizer).
+		// Also false when an index or BVH node points outside its array, the mesh is left empty then
+		bool Load(const std::string& cachePath, uint64_t sourceHash, bool isOptimized, TriangleMesh& mesh, size_t* pByteCount = nullptr);
+		// Written to a temporary file first, a crash never leaves a half cache behind
+		bool Save(const std::string& cachePath, uint64_t sourceHash, bool isOptimized, const TriangleMesh& mesh);
+	}
+}
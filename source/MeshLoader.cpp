@@ -0,0 +1,859 @@
+//Standard includes
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+//Project includes
+#include "MeshLoader.h"
+#include "MappedFile.h"
+#include "MeshBVH.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+
+namespace dae {
+
+	namespace
+	{
+		// Smaller files aren't worth a thread
+		constexpr size_t g_MinChunkBytes{ 1024 * 1024 };
+
+		enum ObjElement
+		{
+			Position,
+			Texcoord,
+			Normal,
+			ElementCount
+		};
+
+		// Index into the elements of one kind, -1 when absent.
+		// Negative indices in the file count back from the last element read, those are relative to the start of the chunk until the chunks are merged.
+		struct ObjCorner
+		{
+			int index[ElementCount]{ -1, -1, -1 };
+			uint8_t relativeMask{};
+		};
+
+		struct ObjChunk
+		{
+			const char* pBegin{};
+			const char* pEnd{};
+
+			std::vector<Vector3> positions{};
+			std::vector<float> texcoords{};
+			std::vector<Vector3> normals{};
+			std::vector<ObjCorner> corners{};	// 3 per triangle
+			bool isValid{ true };
+
+			size_t GetCount(int element) const
+			{
+				switch (element)
+				{
+				case Position: return positions.size();
+				case Texcoord: return texcoords.size() / 2;
+				default: return normals.size();
+				}
+			}
+		};
+
+		// A thread per job, the pool only lives for this call (loading isn't on the frame loop)
+		void RunParallel(size_t jobCount, const std::function<void(size_t)>& job)
+		{
+			ThreadPool threadPool{ static_cast<int>(jobCount) };
+			threadPool.ForEachJob(static_cast<int>(jobCount), [&](int jobIdx) { job(static_cast<size_t>(jobIdx)); });
+		}
+
+		const char* SkipSpaces(const char* p, const char* pEnd)
+		{
+			while (p < pEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+				++p;
+			return p;
+		}
+
+		bool IsSpace(const char* p, const char* pEnd)
+		{
+			return p == pEnd || *p == ' ' || *p == '\t' || *p == '\r';
+		}
+
+		bool ParseFloat(const char*& p, const char* pEnd, float& value)
+		{
+			p = SkipSpaces(p, pEnd);
+			// from_chars doesn't take a leading '+'
+			if (p < pEnd && *p == '+')
+				++p;
+
+			const auto [pNext, error] { std::from_chars(p, pEnd, value) };
+			if (error != std::errc{})
+				return false;
+
+			p = pNext;
+			return true;
+		}
+
+		// 1 based, or negative counting back from the last element read so far
+		bool ParseIndex(const char*& p, const char* pEnd, size_t readCount, ObjCorner& corner, int element)
+		{
+			int value{};
+			const auto [pNext, error] { std::from_chars(p, pEnd, value) };
+			if (error != std::errc{} || value == 0)
+				return false;
+
+			p = pNext;
+			if (value > 0)
+			{
+				corner.index[element] = value - 1;
+			}
+			else
+			{
+				corner.index[element] = static_cast<int>(readCount) + value;
+				corner.relativeMask |= 1 << element;
+			}
+			return true;
+		}
+
+		bool ParseFace(const char* p, const char* pEnd, ObjChunk& chunk, std::vector<ObjCorner>& faceCorners)
+		{
+			faceCorners.clear();
+
+			for (p = SkipSpaces(p, pEnd); p < pEnd; p = SkipSpaces(p, pEnd))
+			{
+				// v, v/vt, v//vn or v/vt/vn
+				ObjCorner corner{};
+				if (!ParseIndex(p, pEnd, chunk.positions.size(), corner, Position))
+					return false;
+
+				if (p < pEnd && *p == '/')
+				{
+					++p;
+					if (p < pEnd && *p != '/' && !ParseIndex(p, pEnd, chunk.texcoords.size() / 2, corner, Texcoord))
+						return false;
+
+					if (p < pEnd && *p == '/')
+					{
+						++p;
+						if (!ParseIndex(p, pEnd, chunk.normals.size(), corner, Normal))
+							return false;
+					}
+				}
+
+				if (!IsSpace(p, pEnd))
+					return false;
+
+				faceCorners.push_back(corner);
+			}
+
+			// Fan around the first corner, fine for the convex polygons exporters write
+			for (size_t cornerIdx{ 2 }; cornerIdx < faceCorners.size(); ++cornerIdx)
+			{
+				chunk.corners.push_back(faceCorners[0]);
+				chunk.corners.push_back(faceCorners[cornerIdx - 1]);
+				chunk.corners.push_back(faceCorners[cornerIdx]);
+			}
+			return true;
+		}
+
+		bool ParseLine(const char* p, const char* pEnd, ObjChunk& chunk, std::vector<ObjCorner>& faceCorners)
+		{
+			p = SkipSpaces(p, pEnd);
+			if (p == pEnd)
+				return true;
+
+			if (p[0] == 'v')
+			{
+				if (IsSpace(p + 1, pEnd))
+				{
+					// "v x y z [w]", w is ignored
+					Vector3 position{};
+					p += 1;
+					if (!ParseFloat(p, pEnd, position.x) || !ParseFloat(p, pEnd, position.y) || !ParseFloat(p, pEnd, position.z))
+						return false;
+					chunk.positions.push_back(position);
+				}
+				else if (p[1] == 't' && IsSpace(p + 2, pEnd))
+				{
+					// "vt u [v [w]]"
+					float u{}, v{};
+					p += 2;
+					if (!ParseFloat(p, pEnd, u))
+						return false;
+					ParseFloat(p, pEnd, v);
+					chunk.texcoords.push_back(u);
+					chunk.texcoords.push_back(v);
+				}
+				else if (p[1] == 'n' && IsSpace(p + 2, pEnd))
+				{
+					Vector3 normal{};
+					p += 2;
+					if (!ParseFloat(p, pEnd, normal.x) || !ParseFloat(p, pEnd, normal.y) || !ParseFloat(p, pEnd, normal.z))
+						return false;
+					chunk.normals.push_back(normal);
+				}
+			}
+			else if (p[0] == 'f' && IsSpace(p + 1, pEnd))
+			{
+				return ParseFace(p + 1, pEnd, chunk, faceCorners);
+			}
+
+			// Comments, groups, materials, smoothing groups, lines and points are skipped
+			return true;
+		}
+
+		void ParseChunk(ObjChunk& chunk)
+		{
+			std::vector<ObjCorner> faceCorners{};
+
+			for (const char* pLine{ chunk.pBegin }; pLine < chunk.pEnd && chunk.isValid;)
+			{
+				const char* pLineEnd{ static_cast<const char*>(std::memchr(pLine, '\n', chunk.pEnd - pLine)) };
+				if (!pLineEnd)
+					pLineEnd = chunk.pEnd;
+
+				chunk.isValid = ParseLine(pLine, pLineEnd, chunk, faceCorners);
+				pLine = pLineEnd + 1;
+			}
+		}
+	}
+
+	bool MeshLoader::ParseOBJ(const std::string& path, ObjData& data, int threadCount, MeshLoadStats* pStats)
+	{
+		const auto startTime{ std::chrono::steady_clock::now() };
+
+		MappedFile file{};
+		if (!file.Open(path))
+			return false;
+
+		const char* pData{ file.GetData() };
+		const size_t size{ file.GetSize() };
+
+		// Chunks end right after a newline so no line is split
+		if (threadCount <= 0)
+			threadCount = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+		const size_t chunkCount{ std::clamp<size_t>(size / g_MinChunkBytes, 1, threadCount) };
+
+		std::vector<ObjChunk> chunks(chunkCount);
+		const char* pChunkBegin{ pData };
+		for (size_t chunkIdx{}; chunkIdx < chunkCount; ++chunkIdx)
+		{
+			const char* pChunkEnd{ pData + size };
+			if (chunkIdx + 1 < chunkCount)
+			{
+				const char* pTarget{ std::max(pData + size * (chunkIdx + 1) / chunkCount, pChunkBegin) };
+				const char* pNewline{ static_cast<const char*>(std::memchr(pTarget, '\n', pData + size - pTarget)) };
+				pChunkEnd = pNewline ? pNewline + 1 : pData + size;
+			}
+
+			chunks[chunkIdx].pBegin = pChunkBegin;
+			chunks[chunkIdx].pEnd = pChunkEnd;
+			pChunkBegin = pChunkEnd;
+		}
+
+		RunParallel(chunkCount, [&](size_t chunkIdx) { ParseChunk(chunks[chunkIdx]); });
+
+		// First element and corner of every chunk in the merged arrays
+		std::vector<size_t> elementOffsets(chunkCount * ElementCount);
+		std::vector<size_t> cornerOffsets(chunkCount);
+		size_t elementTotals[ElementCount]{};
+		size_t cornerTotal{};
+		for (size_t chunkIdx{}; chunkIdx < chunkCount; ++chunkIdx)
+		{
+			if (!chunks[chunkIdx].isValid)
+				return false;
+
+			for (int element{}; element < ElementCount; ++element)
+			{
+				elementOffsets[chunkIdx * ElementCount + element] = elementTotals[element];
+				elementTotals[element] += chunks[chunkIdx].GetCount(element);
+			}
+			cornerOffsets[chunkIdx] = cornerTotal;
+			cornerTotal += chunks[chunkIdx].corners.size();
+		}
+
+		data.positions.resize(elementTotals[Position]);
+		data.texcoords.resize(elementTotals[Texcoord] * 2);
+		data.normals.resize(elementTotals[Normal]);
+		data.positionIndices.resize(cornerTotal);
+		data.texcoordIndices.resize(cornerTotal);
+		data.normalIndices.resize(cornerTotal);
+
+		std::vector<uint8_t> isChunkResolved(chunkCount, 1);
+		RunParallel(chunkCount, [&](size_t chunkIdx)
+			{
+				const ObjChunk& chunk{ chunks[chunkIdx] };
+				const size_t* pOffsets{ &elementOffsets[chunkIdx * ElementCount] };
+
+				std::copy(chunk.positions.begin(), chunk.positions.end(), data.positions.begin() + pOffsets[Position]);
+				std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), data.texcoords.begin() + pOffsets[Texcoord] * 2);
+				std::copy(chunk.normals.begin(), chunk.normals.end(), data.normals.begin() + pOffsets[Normal]);
+
+				std::vector<int>* indexArrays[ElementCount]{ &data.positionIndices, &data.texcoordIndices, &data.normalIndices };
+				for (size_t cornerIdx{}; cornerIdx < chunk.corners.size(); ++cornerIdx)
+				{
+					const ObjCorner& corner{ chunk.corners[cornerIdx] };
+					for (int element{}; element < ElementCount; ++element)
+					{
+						int64_t index{ corner.index[element] };
+						if (corner.relativeMask & (1 << element))
+							index += pOffsets[element];
+
+						const bool isAbsent{ index == -1 && !(corner.relativeMask & (1 << element)) };
+						if (!isAbsent && (index < 0 || index >= static_cast<int64_t>(elementTotals[element])))
+						{
+							isChunkResolved[chunkIdx] = 0;
+							return;
+						}
+
+						(*indexArrays[element])[cornerOffsets[chunkIdx] + cornerIdx] = static_cast<int>(index);
+					}
+				}
+			});
+
+		if (std::find(isChunkResolved.begin(), isChunkResolved.end(), 0) != isChunkResolved.end())
+			return false;
+
+		if (pStats)
+		{
+			pStats->byteCount = size;
+			pStats->triangleCount = cornerTotal / 3;
+			pStats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		}
+		return true;
+	}
+
+	namespace
+	{
+		enum class PlyFormat
+		{
+			Ascii,
+			BinaryLittleEndian,
+			BinaryBigEndian
+		};
+
+		enum class PlyType
+		{
+			Int8,
+			UInt8,
+			Int16,
+			UInt16,
+			Int32,
+			UInt32,
+			Float32,
+			Float64,
+			Invalid
+		};
+
+		struct PlyProperty
+		{
+			std::string name{};
+			PlyType type{ PlyType::Invalid };
+			PlyType countType{ PlyType::Invalid };	// Set for list properties, type is the type of the items then
+
+			bool IsList() const { return countType != PlyType::Invalid; }
+		};
+
+		struct PlyElement
+		{
+			std::string name{};
+			size_t count{};
+			std::vector<PlyProperty> properties{};
+		};
+
+		PlyType GetPlyType(const std::string& name)
+		{
+			if (name == "char" || name == "int8")		return PlyType::Int8;
+			if (name == "uchar" || name == "uint8")		return PlyType::UInt8;
+			if (name == "short" || name == "int16")		return PlyType::Int16;
+			if (name == "ushort" || name == "uint16")	return PlyType::UInt16;
+			if (name == "int" || name == "int32")		return PlyType::Int32;
+			if (name == "uint" || name == "uint32")		return PlyType::UInt32;
+			if (name == "float" || name == "float32")	return PlyType::Float32;
+			if (name == "double" || name == "float64")	return PlyType::Float64;
+			return PlyType::Invalid;
+		}
+
+		size_t GetPlySize(PlyType type)
+		{
+			switch (type)
+			{
+			case PlyType::Int8:
+			case PlyType::UInt8:	return 1;
+			case PlyType::Int16:
+			case PlyType::UInt16:	return 2;
+			case PlyType::Int32:
+			case PlyType::UInt32:
+			case PlyType::Float32:	return 4;
+			case PlyType::Float64:	return 8;
+			default:				return 0;
+			}
+		}
+
+		// Bytes per instance, 0 when a list makes the size vary
+		size_t GetPlyStride(const PlyElement& element)
+		{
+			size_t stride{};
+			for (const PlyProperty& property : element.properties)
+			{
+				if (property.IsList())
+					return 0;
+				stride += GetPlySize(property.type);
+			}
+			return stride;
+		}
+
+		// Offset of a fixed size property in an instance, -1 when it's missing or follows a list
+		int GetPlyOffset(const PlyElement& element, const std::string& name)
+		{
+			size_t offset{};
+			for (const PlyProperty& property : element.properties)
+			{
+				if (property.name == name)
+					return static_cast<int>(offset);
+				if (property.IsList())
+					return -1;
+				offset += GetPlySize(property.type);
+			}
+			return -1;
+		}
+
+		// Walks the body value by value, for everything the bulk copies don't cover
+		struct PlyReader
+		{
+			const char* p{};
+			const char* pEnd{};
+			PlyFormat format{};
+
+			bool Read(PlyType type, double& value)
+			{
+				if (format == PlyFormat::Ascii)
+				{
+					while (p < pEnd && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+						++p;
+					if (p < pEnd && *p == '+')
+						++p;
+
+					const auto [pNext, error] { std::from_chars(p, pEnd, value) };
+					p = pNext;
+					return error == std::errc{};
+				}
+
+				const size_t size{ GetPlySize(type) };
+				if (size == 0 || static_cast<size_t>(pEnd - p) < size)
+					return false;
+
+				uint8_t bytes[8]{};
+				std::memcpy(bytes, p, size);
+				p += size;
+				if ((format == PlyFormat::BinaryBigEndian) != (std::endian::native == std::endian::big))
+					std::reverse(bytes, bytes + size);
+
+				switch (type)
+				{
+				case PlyType::Int8:		value = static_cast<double>(*reinterpret_cast<const int8_t*>(bytes)); break;
+				case PlyType::UInt8:	value = static_cast<double>(bytes[0]); break;
+				case PlyType::Int16:	{ int16_t v; std::memcpy(&v, bytes, 2); value = v; break; }
+				case PlyType::UInt16:	{ uint16_t v; std::memcpy(&v, bytes, 2); value = v; break; }
+				case PlyType::Int32:	{ int32_t v; std::memcpy(&v, bytes, 4); value = v; break; }
+				case PlyType::UInt32:	{ uint32_t v; std::memcpy(&v, bytes, 4); value = v; break; }
+				case PlyType::Float32:	{ float v; std::memcpy(&v, bytes, 4); value = v; break; }
+				default:				{ double v; std::memcpy(&v, bytes, 8); value = v; break; }
+				}
+				return true;
+			}
+
+			// The counts in the header are only trusted when what's left of the file can hold that many instances:
+			// a binary instance is at least its fixed size properties and list counts, an ASCII value at least one character
+			bool CanHold(const PlyElement& element) const
+			{
+				size_t minimumSize{};
+				for (const PlyProperty& property : element.properties)
+				{
+					minimumSize += format == PlyFormat::Ascii ? 1 : GetPlySize(property.IsList() ? property.countType : property.type);
+				}
+				return element.count == 0 || (minimumSize > 0 && element.count <= static_cast<size_t>(pEnd - p) / minimumSize);
+			}
+
+			bool Skip(const PlyProperty& property)
+			{
+				double value{};
+				if (!property.IsList())
+					return Read(property.type, value);
+
+				if (!Read(property.countType, value) || value < 0)
+					return false;
+
+				// Binary lists skip in one step
+				const size_t itemCount{ static_cast<size_t>(value) };
+				if (format != PlyFormat::Ascii)
+				{
+					const size_t size{ itemCount * GetPlySize(property.type) };
+					if (static_cast<size_t>(pEnd - p) < size)
+						return false;
+					p += size;
+					return true;
+				}
+
+				for (size_t itemIdx{}; itemIdx < itemCount; ++itemIdx)
+				{
+					if (!Read(property.type, value))
+						return false;
+				}
+				return true;
+			}
+		};
+
+		// Header up to and including "end_header\n", p is left at the first byte of the body
+		bool ParsePlyHeader(const char*& p, const char* pEnd, PlyFormat& format, std::vector<PlyElement>& elements)
+		{
+			bool isFirstLine{ true };
+			bool hasFormat{ false };
+			while (p < pEnd)
+			{
+				const char* pLineEnd{ static_cast<const char*>(std::memchr(p, '\n', pEnd - p)) };
+				if (!pLineEnd)
+					return false;
+
+				std::istringstream line{ std::string{ p, pLineEnd } };
+				p = pLineEnd + 1;
+
+				std::string keyword{};
+				line >> keyword;
+				if (isFirstLine)
+				{
+					if (keyword != "ply")
+						return false;
+					isFirstLine = false;
+				}
+				else if (keyword == "format")
+				{
+					std::string name{};
+					line >> name;
+					if (name == "ascii")						format = PlyFormat::Ascii;
+					else if (name == "binary_little_endian")	format = PlyFormat::BinaryLittleEndian;
+					else if (name == "binary_big_endian")		format = PlyFormat::BinaryBigEndian;
+					else return false;
+					hasFormat = true;
+				}
+				else if (keyword == "element")
+				{
+					PlyElement element{};
+					line >> element.name >> element.count;
+					if (!line)
+						return false;
+					elements.push_back(element);
+				}
+				else if (keyword == "property")
+				{
+					if (elements.empty())
+						return false;
+
+					PlyProperty property{};
+					std::string type{};
+					line >> type;
+					if (type == "list")
+					{
+						std::string countType{};
+						line >> countType >> type;
+						property.countType = GetPlyType(countType);
+						if (property.countType == PlyType::Invalid)
+							return false;
+					}
+					property.type = GetPlyType(type);
+					line >> property.name;
+					if (!line || property.type == PlyType::Invalid)
+						return false;
+					elements.back().properties.push_back(property);
+				}
+				else if (keyword == "end_header")
+				{
+					return hasFormat;
+				}
+				// comment, obj_info
+			}
+			return false;
+		}
+
+		bool ReadPlyVertices(PlyReader& reader, const PlyElement& element, std::vector<Vector3>& positions)
+		{
+			if (!reader.CanHold(element))
+				return false;
+			positions.resize(element.count);
+
+			// Binary with x, y, z as 3 consecutive floats in the byte order of this machine: straight copies
+			const size_t stride{ GetPlyStride(element) };
+			const int offsetX{ GetPlyOffset(element, "x") };
+			const bool isNativeOrder{ (reader.format == PlyFormat::BinaryBigEndian) == (std::endian::native == std::endian::big) };
+			if (reader.format != PlyFormat::Ascii && isNativeOrder && stride > 0 && offsetX >= 0
+				&& GetPlyOffset(element, "y") == offsetX + 4 && GetPlyOffset(element, "z") == offsetX + 8
+				&& std::all_of(element.properties.begin(), element.properties.end(), [](const PlyProperty& property)
+					{
+						return property.type == PlyType::Float32 || (property.name != "x" && property.name != "y" && property.name != "z");
+					}))
+			{
+				if (static_cast<size_t>(reader.pEnd - reader.p) < element.count * stride)
+					return false;
+
+				if (stride == sizeof(Vector3))
+				{
+					std::memcpy(positions.data(), reader.p, element.count * stride);
+				}
+				else
+				{
+					for (size_t vertexIdx{}; vertexIdx < element.count; ++vertexIdx)
+					{
+						std::memcpy(&positions[vertexIdx], reader.p + vertexIdx * stride + offsetX, sizeof(Vector3));
+					}
+				}
+				reader.p += element.count * stride;
+				return true;
+			}
+
+			for (Vector3& position : positions)
+			{
+				for (const PlyProperty& property : element.properties)
+				{
+					double value{};
+					if (!property.IsList() && (property.name == "x" || property.name == "y" || property.name == "z"))
+					{
+						if (!reader.Read(property.type, value))
+							return false;
+						position[property.name[0] - 'x'] = static_cast<float>(value);
+					}
+					else if (!reader.Skip(property))
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		bool ReadPlyFaces(PlyReader& reader, const PlyElement& element, std::vector<int>& indices)
+		{
+			indices.clear();
+			if (!reader.CanHold(element))
+				return false;
+			indices.reserve(element.count * 3);
+
+			// Binary faces with nothing but a uchar count and int indices, triangles are one 12 byte copy
+			const PlyProperty& first{ element.properties.front() };
+			const bool isNativeOrder{ (reader.format == PlyFormat::BinaryBigEndian) == (std::endian::native == std::endian::big) };
+			if (reader.format != PlyFormat::Ascii && isNativeOrder && element.properties.size() == 1 && first.IsList()
+				&& GetPlySize(first.countType) == 1 && (first.type == PlyType::Int32 || first.type == PlyType::UInt32))
+			{
+				for (size_t faceIdx{}; faceIdx < element.count; ++faceIdx)
+				{
+					if (reader.p == reader.pEnd)
+						return false;
+
+					const size_t cornerCount{ static_cast<uint8_t>(*reader.p++) };
+					if (static_cast<size_t>(reader.pEnd - reader.p) < cornerCount * 4)
+						return false;
+
+					if (cornerCount == 3)
+					{
+						const size_t triangleIdx{ indices.size() };
+						indices.resize(triangleIdx + 3);
+						std::memcpy(&indices[triangleIdx], reader.p, 12);
+					}
+					else
+					{
+						for (size_t cornerIdx{ 2 }; cornerIdx < cornerCount; ++cornerIdx)
+						{
+							int corners[3]{};
+							std::memcpy(&corners[0], reader.p, 4);
+							std::memcpy(&corners[1], reader.p + (cornerIdx - 1) * 4, 4);
+							std::memcpy(&corners[2], reader.p + cornerIdx * 4, 4);
+							indices.insert(indices.end(), corners, corners + 3);
+						}
+					}
+					reader.p += cornerCount * 4;
+				}
+				return true;
+			}
+
+			std::vector<int> faceCorners{};
+			for (size_t faceIdx{}; faceIdx < element.count; ++faceIdx)
+			{
+				for (const PlyProperty& property : element.properties)
+				{
+					if (!property.IsList() || (property.name != "vertex_indices" && property.name != "vertex_index"))
+					{
+						if (!reader.Skip(property))
+							return false;
+						continue;
+					}
+
+					double value{};
+					if (!reader.Read(property.countType, value) || value < 0)
+						return false;
+
+					faceCorners.resize(static_cast<size_t>(value));
+					for (int& corner : faceCorners)
+					{
+						if (!reader.Read(property.type, value))
+							return false;
+						corner = static_cast<int>(value);
+					}
+
+					// Fan, same as the OBJ parser
+					for (size_t cornerIdx{ 2 }; cornerIdx < faceCorners.size(); ++cornerIdx)
+					{
+						indices.push_back(faceCorners[0]);
+						indices.push_back(faceCorners[cornerIdx - 1]);
+						indices.push_back(faceCorners[cornerIdx]);
+					}
+				}
+			}
+			return true;
+		}
+	}
+
+	bool MeshLoader::ParsePLY(const std::string& path, std::vector<Vector3>& positions, std::vector<int>& indices, MeshLoadStats* pStats)
+	{
+		const auto startTime{ std::chrono::steady_clock::now() };
+
+		MappedFile file{};
+		if (!file.Open(path))
+			return false;
+
+		PlyReader reader{ file.GetData(), file.GetData() + file.GetSize() };
+		std::vector<PlyElement> elements{};
+		if (!ParsePlyHeader(reader.p, reader.pEnd, reader.format, elements))
+			return false;
+
+		positions.clear();
+		indices.clear();
+
+		// Elements follow each other in header order, everything but vertices and faces is skipped
+		for (const PlyElement& element : elements)
+		{
+			bool isRead{ true };
+			if (element.name == "vertex")
+			{
+				isRead = ReadPlyVertices(reader, element, positions);
+			}
+			else if (element.name == "face" && !element.properties.empty())
+			{
+				isRead = ReadPlyFaces(reader, element, indices);
+			}
+			else
+			{
+				for (size_t instanceIdx{}; instanceIdx < element.count && isRead; ++instanceIdx)
+				{
+					for (const PlyProperty& property : element.properties)
+					{
+						isRead = isRead && reader.Skip(property);
+					}
+				}
+			}
+
+			if (!isRead)
+				return false;
+		}
+
+		const int vertexCount{ static_cast<int>(positions.size()) };
+		if (std::any_of(indices.begin(), indices.end(), [vertexCount](int index) { return index < 0 || index >= vertexCount; }))
+			return false;
+
+		if (pStats)
+		{
+			pStats->byteCount = file.GetSize();
+			pStats->triangleCount = indices.size() / 3;
+			pStats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		}
+		return true;
+	}
+
+	bool MeshLoader::LoadMesh(const std::string& path, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices,
+		MeshLoadStats* pStats)
+	{
+		const auto startTime{ std::chrono::steady_clock::now() };
+
+		std::string extension{ path.substr(std::min(path.find_last_of('.'), path.size())) };
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		MeshLoadStats stats{};
+		if (extension == ".obj")
+		{
+			ObjData data{};
+			if (!ParseOBJ(path, data, 0, &stats))
+				return false;
+
+			positions = std::move(data.positions);
+			indices = std::move(data.positionIndices);
+		}
+		else if (extension == ".ply")
+		{
+			if (!ParsePLY(path, positions, indices, &stats))
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+
+		CalculateFaceNormals(positions, indices, normals);
+
+		if (pStats)
+		{
+			*pStats = stats;
+			pStats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		}
+		return true;
+	}
+
+	bool MeshLoader::LoadTriangleMesh(const std::string& path, TriangleMesh& mesh, bool useCache, bool optimize, MeshLoadStats* pStats)
+	{
+		const auto startTime{ std::chrono::steady_clock::now() };
+
+		MeshLoadStats stats{};
+		uint64_t sourceHash{};
+		const std::string cachePath{ MeshCache::GetCachePath(path) };
+		if (useCache && MeshCache::HashFile(path, sourceHash) && MeshCache::Load(cachePath, sourceHash, optimize, mesh, &stats.byteCount))
+		{
+			stats.isFromCache = true;
+			// The cache holds int indices, narrowed the same way as after MeshOptimizer::Optimize
+			if (optimize)
+				mesh.NarrowIndices();
+		}
+		else
+		{
+			if (!LoadMesh(path, mesh.positions, mesh.normals, mesh.indices, &stats))
+				return false;
+
+			if (optimize)
+				MeshOptimizer::Optimize(mesh);
+			MeshBVH::Build(mesh);
+			if (useCache)
+				MeshCache::Save(cachePath, sourceHash, optimize, mesh);
+		}
+
+		if (pStats)
+		{
+			*pStats = stats;
+			pStats->triangleCount = mesh.GetTriangleCount();
+			pStats->vertexCount = mesh.positions.size();
+			pStats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		}
+		return true;
+	}
+
+	void MeshLoader::CalculateFaceNormals(const std::vector<Vector3>& positions, const std::vector<int>& indices, std::vector<Vector3>& normals)
+	{
+		normals.resize(indices.size() / 3);
+		for (size_t triangleIdx{}; triangleIdx < normals.size(); ++triangleIdx)
+		{
+			const Vector3& v0{ positions[indices[triangleIdx * 3]] };
+			const Vector3 edgeV0V1{ positions[indices[triangleIdx * 3 + 1]] - v0 };
+			const Vector3 edgeV0V2{ positions[indices[triangleIdx * 3 + 2]] - v0 };
+
+			normals[triangleIdx] = Vector3::Cross(edgeV0V1, edgeV0V2).Normalized();
+		}
+	}
+}
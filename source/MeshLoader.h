@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Math.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	// Size and load time of one mesh file
+	struct MeshLoadStats
+	{
+		size_t byteCount{};
+		size_t triangleCount{};
+		double seconds{};
+		bool isFromCache{ false };	// byteCount is the size of the cache file then
+		size_t vertexCount{};
+
+		double GetMegabytesPerSecond() const { return seconds > 0.0 ? byteCount / (1024.0 * 1024.0) / seconds : 0.0; }
+	};
+
+	// Everything the OBJ parser keeps. Faces are fan triangulated, every corner indexes
+	// positions, texcoords and normals (0 based, -1 when the face doesn't reference one)
+	struct ObjData
+	{
+		std::vector<Vector3> positions{};
+		std::vector<float> texcoords{};		// u, v pairs
+		std::vector<Vector3> normals{};		// Vertex normals as written in the file ("vn")
+
+		std::vector<int> positionIndices{};
+		std::vector<int> texcoordIndices{};
+		std::vector<int> normalIndices{};
+	};
+
+	namespace MeshLoader
+	{
+		// Memory maps the file and parses chunks of lines on threadCount threads (0 = all cores).
+		// Supports v, vt, vn, f with v, v/vt, v//vn and v/vt/vn corners, negative (relative) indices and n-gons.
+		// False when the file can't be read or a face references an element that doesn't exist.
+		bool ParseOBJ(const std::string& path, ObjData& data, int threadCount = 0, MeshLoadStats* pStats = nullptr);
+
+		// Binary (either byte order) and ASCII PLY, the x, y, z of the vertices and the vertex_indices of the faces (n-gons fan triangulated).
+		// Binary float x, y, z are copied as one block (one copy per vertex when there are more properties), triangles as one copy per face.
+		// False on a header it doesn't understand, a short file or indices out of range
+		bool ParsePLY(const std::string& path, std::vector<Vector3>& positions, std::vector<int>& indices, MeshLoadStats* pStats = nullptr);
+
+		// Loads a mesh into the layout of TriangleMesh: positions, 3 indices and one face normal per triangle.
+		// Picks the parser from the extension (.obj, .ply)
+		bool LoadMesh(const std::string& path, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices,
+			MeshLoadStats* pStats = nullptr);
+
+		// LoadMesh, MeshOptimizer::Optimize when optimize is set, plus a BVH, through the binary cache next to the file (MeshCache)
+		// when its source hash still matches. Writes the cache after a parse when useCache is set, a read-only directory only costs the speed-up
+		bool LoadTriangleMesh(const std::string& path, TriangleMesh& mesh, bool useCache = true, bool optimize = true, MeshLoadStats* pStats = nullptr);
+
+		// One normal per triangle from the winding of its corners
+		void CalculateFaceNormals(const std::vector<Vector3>& positions, const std::vector<int>& indices, std::vector<Vector3>& normals);
+	}
+}
@@ -0,0 +1,184 @@
+//Standard includes
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+//Project includes
+#include "MeshOptimizer.h"
+
+namespace dae {
+
+	namespace
+	{
+		// Morton codes use 10 bits per axis
+		constexpr float g_MortonGridSize{ 1023.f };
+
+		// Bit pattern of a position, welding only merges vertices that are exactly the same
+		struct VertexKey
+		{
+			uint32_t bits[3]{};
+
+			bool operator==(const VertexKey& other) const = default;
+		};
+
+		struct VertexKeyHash
+		{
+			size_t operator()(const VertexKey& key) const
+			{
+				uint64_t hash{ 0xCBF29CE484222325ull };
+				for (const uint32_t bits : key.bits)
+				{
+					hash = (hash ^ bits) * 0x9E3779B97F4A7C15ull;
+				}
+				return static_cast<size_t>(hash ^ (hash >> 32));
+			}
+		};
+
+		VertexKey GetVertexKey(const Vector3& position)
+		{
+			// Adding 0 turns -0 into +0, both are the same point
+			const float coordinates[3]{ position.x + 0.f, position.y + 0.f, position.z + 0.f };
+
+			VertexKey key{};
+			std::memcpy(key.bits, coordinates, sizeof(coordinates));
+			return key;
+		}
+
+		// Puts two zero bits in front of each of the lower 10 bits
+		uint32_t SpreadBits(uint32_t value)
+		{
+			value &= 0x3FF;
+			value = (value | (value << 16)) & 0x030000FF;
+			value = (value | (value << 8)) & 0x0300F00F;
+			value = (value | (value << 4)) & 0x030C30C3;
+			value = (value | (value << 2)) & 0x09249249;
+			return value;
+		}
+
+		uint32_t GetMortonCode(const Vector3& point, const Vector3& minAABB, const Vector3& scale)
+		{
+			const auto quantize = [](float value) { return static_cast<uint32_t>(std::clamp(value, 0.f, g_MortonGridSize)); };
+
+			return (SpreadBits(quantize((point.x - minAABB.x) * scale.x)) << 2)
+				| (SpreadBits(quantize((point.y - minAABB.y) * scale.y)) << 1)
+				| SpreadBits(quantize((point.z - minAABB.z) * scale.z));
+		}
+	}
+
+	void MeshOptimizer::Optimize(TriangleMesh& mesh, MeshOptimizeStats* pStats)
+	{
+		// Welding rewrites the int indices in place
+		mesh.WidenIndices();
+
+		const size_t inputVertexCount{ mesh.positions.size() };
+		const size_t inputTriangleCount{ mesh.indices.size() / 3 };
+		const bool hasFaceNormals{ mesh.normals.size() == inputTriangleCount };
+
+		// Every vertex points at the first vertex with its position
+		std::vector<int> weldedIndices(inputVertexCount);
+		{
+			std::unordered_map<VertexKey, int, VertexKeyHash> firstVertices{};
+			firstVertices.reserve(inputVertexCount);
+			for (size_t idx{}; idx < inputVertexCount; ++idx)
+			{
+				weldedIndices[idx] = firstVertices.try_emplace(GetVertexKey(mesh.positions[idx]), static_cast<int>(idx)).first->second;
+			}
+		}
+
+		// Triangles that keep an area after welding, with the bounds of their corners
+		std::vector<uint32_t> triangles{};
+		triangles.reserve(inputTriangleCount);
+		Vector3 minAABB{ FLT_MAX, FLT_MAX, FLT_MAX };
+		Vector3 maxAABB{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (size_t triangleIdx{}; triangleIdx < inputTriangleCount; ++triangleIdx)
+		{
+			int* pCorners{ &mesh.indices[triangleIdx * 3] };
+			for (int corner{}; corner < 3; ++corner)
+			{
+				pCorners[corner] = weldedIndices[pCorners[corner]];
+			}
+
+			const Vector3& v0{ mesh.positions[pCorners[0]] };
+			const Vector3& v1{ mesh.positions[pCorners[1]] };
+			const Vector3& v2{ mesh.positions[pCorners[2]] };
+
+			// Also false for NaN, a normal can't be made from it either way
+			const float areaSquared{ Vector3::Cross(v1 - v0, v2 - v0).SqrMagnitude() };
+			if (!(areaSquared > 0.f) || !std::isfinite(areaSquared))
+			{
+				continue;
+			}
+
+			triangles.push_back(static_cast<uint32_t>(triangleIdx));
+			minAABB = Vector3::Min(Vector3::Min(minAABB, v0), Vector3::Min(v1, v2));
+			maxAABB = Vector3::Max(Vector3::Max(maxAABB, v0), Vector3::Max(v1, v2));
+		}
+
+		// Morton code of the centroid in the high half, the triangle in the low half: sorting keeps equal codes in file order
+		const Vector3 extent{ maxAABB - minAABB };
+		const Vector3 scale{ extent.x > 0.f ? g_MortonGridSize / extent.x : 0.f, extent.y > 0.f ? g_MortonGridSize / extent.y : 0.f,
+			extent.z > 0.f ? g_MortonGridSize / extent.z : 0.f };
+
+		std::vector<uint64_t> sortKeys(triangles.size());
+		for (size_t idx{}; idx < triangles.size(); ++idx)
+		{
+			const int* pCorners{ &mesh.indices[size_t{ triangles[idx] } * 3] };
+			const Vector3 centroid{ (mesh.positions[pCorners[0]] + mesh.positions[pCorners[1]] + mesh.positions[pCorners[2]]) / 3.f };
+			sortKeys[idx] = (uint64_t{ GetMortonCode(centroid, minAABB, scale) } << 32) | triangles[idx];
+		}
+		std::sort(sortKeys.begin(), sortKeys.end());
+
+		// Vertices in order of first use, the ones no triangle uses anymore are dropped
+		std::vector<int> vertexRemap(inputVertexCount, -1);
+		std::vector<Vector3> positions{};
+		std::vector<Vector3> normals{};
+		std::vector<int> indices{};
+		positions.reserve(std::min(inputVertexCount, sortKeys.size() * 3));
+		indices.reserve(sortKeys.size() * 3);
+		if (hasFaceNormals)
+		{
+			normals.reserve(sortKeys.size());
+		}
+
+		for (const uint64_t sortKey : sortKeys)
+		{
+			const size_t triangleIdx{ static_cast<uint32_t>(sortKey) };
+			for (size_t corner{}; corner < 3; ++corner)
+			{
+				const int vertexIdx{ mesh.indices[triangleIdx * 3 + corner] };
+				if (vertexRemap[vertexIdx] < 0)
+				{
+					vertexRemap[vertexIdx] = static_cast<int>(positions.size());
+					positions.push_back(mesh.positions[vertexIdx]);
+				}
+				indices.push_back(vertexRemap[vertexIdx]);
+			}
+
+			if (hasFaceNormals)
+			{
+				normals.push_back(mesh.normals[triangleIdx]);
+			}
+		}
+
+		mesh.positions = std::move(positions);
+		mesh.normals = std::move(normals);
+		mesh.indices = std::move(indices);
+		mesh.NarrowIndices();
+
+		// Nothing of these matches the new order, UpdateTransforms and MeshBVH::Build make them again
+		mesh.transformedPositions.clear();
+		mesh.transformedNormals.clear();
+		mesh.bvhNodes.clear();
+		mesh.bvhTriangles.clear();
+
+		if (pStats)
+		{
+			pStats->inputVertexCount = inputVertexCount;
+			pStats->inputTriangleCount = inputTriangleCount;
+			pStats->vertexCount = mesh.positions.size();
+			pStats->triangleCount = mesh.GetTriangleCount();
+		}
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	// Vertex and triangle counts before and after MeshOptimizer::Optimize
+	struct MeshOptimizeStats
+	{
+		size_t inputVertexCount{};
+		size_t inputTriangleCount{};
+		size_t vertexCount{};
+		size_t triangleCount{};
+	};
+
+	namespace MeshOptimizer
+	{
+		// Load time pass over positions, indices and the face normals (when there's one per triangle):
+		// - welds vertices with the same position (OBJ and glTF split them on texture and normal seams)
+		// - drops triangles with zero area, repeated corners or non-finite positions, their normals would be NaN
+		// - sorts the triangles along a Morton curve of their centroids and the vertices in order of first use,
+		//   triangles that are close in space are close in memory for the brute force loop and the BVH leaves
+		// - keeps only 16 bit indices when every vertex fits (TriangleMesh::NarrowIndices)
+		// Clears the BVH, build it afterwards
+		void Optimize(TriangleMesh& mesh, MeshOptimizeStats* pStats = nullptr);
+	}
+}
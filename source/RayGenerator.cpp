@@ -0,0 +1,203 @@
+#include "RayGenerator.h"
+#include "Camera.h"
+
+//Standard includes
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE__)
+#define RAYGENERATOR_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace dae {
+
+	void RayGenerator::Update(Camera& camera, int fullWidth, int fullHeight, int x, int y, int width, int height)
+	{
+		// Only the fov, the resolution and the crop window shape the cameraSpace directions
+		const bool needsRebuild{ fullWidth != m_FullWidth || fullHeight != m_FullHeight || x != m_RegionX || y != m_RegionY
+			|| width != m_Width || height != m_Height || camera.fovAngle != m_FovAngle };
+		if (needsRebuild)
+		{
+			m_FullWidth = fullWidth;
+			m_FullHeight = fullHeight;
+			m_RegionX = x;
+			m_RegionY = y;
+			m_Width = width;
+			m_Height = height;
+			m_FovAngle = camera.fovAngle;
+			BuildCameraTable();
+		}
+
+		const Matrix cameraToWorld{ camera.CalculateCameraToWorld() };
+		const Vector3 right{ cameraToWorld.GetAxisX() };
+		const Vector3 up{ cameraToWorld.GetAxisY() };
+		const Vector3 forward{ cameraToWorld.GetAxisZ() };
+
+		auto isSameAxis = [](const Vector3& a, const Vector3& b)
+		{
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		};
+
+		m_Origin = camera.origin;
+
+		// Moving the camera keeps the directions, only a rotation needs a new worldSpace table
+		if (needsRebuild || !isSameAxis(right, m_Right) || !isSameAxis(up, m_Up) || !isSameAxis(forward, m_Forward))
+		{
+			m_Right = right;
+			m_Up = up;
+			m_Forward = forward;
+			RotateTable();
+		}
+	}
+
+	Ray RayGenerator::GetRay(float x, float y) const
+	{
+		// Calculate rasterSpace to cameraSpace, rotation folded into the camera axes
+		const float cx{ (m_RegionX + x) * m_ScaleX + m_OffsetX };
+		const float cy{ (m_RegionY + y) * m_ScaleY + m_OffsetY };
+
+		Vector3 rayDirection{ cx * m_Right + cy * m_Up + m_Forward };
+		rayDirection.Normalize();
+
+		return Ray{ m_Origin, rayDirection };
+	}
+
+	void RayGenerator::GenerateTile(int x0, int y0, int tileWidth, int tileHeight, std::vector<Ray>& rays) const
+	{
+		rays.clear();
+		rays.reserve(static_cast<size_t>(tileWidth * tileHeight));
+
+		const int maxX{ std::min(x0 + tileWidth, m_Width) };
+		const int maxY{ std::min(y0 + tileHeight, m_Height) };
+		for (int py{ y0 }; py < maxY; ++py)
+		{
+			for (int px{ x0 }; px < maxX; ++px)
+			{
+				rays.push_back(GetPixelRay(px, py));
+			}
+		}
+	}
+
+	bool RayGenerator::Project(const Vector3& point, float& x, float& y) const
+	{
+		// WorldSpace to cameraSpace to rasterSpace, inverse of GetRay
+		const Vector3 cameraToPoint{ point - m_Origin };
+		const float z{ Vector3::Dot(cameraToPoint, m_Forward) };
+		if (z <= FLT_EPSILON)
+		{
+			return false;
+		}
+
+		const float cx{ Vector3::Dot(cameraToPoint, m_Right) / z };
+		const float cy{ Vector3::Dot(cameraToPoint, m_Up) / z };
+
+		x = (cx - m_OffsetX) / m_ScaleX - m_RegionX;
+		y = (cy - m_OffsetY) / m_ScaleY - m_RegionY;
+		return true;
+	}
+
+	void RayGenerator::GetFrustumPlanes(std::vector<Plane>& planes) const
+	{
+		// Directions through the corners of the crop window, in order around the border
+		const float minX{ m_RegionX * m_ScaleX + m_OffsetX };
+		const float maxX{ (m_RegionX + m_Width) * m_ScaleX + m_OffsetX };
+		const float minY{ m_RegionY * m_ScaleY + m_OffsetY };
+		const float maxY{ (m_RegionY + m_Height) * m_ScaleY + m_OffsetY };
+		const float cornerX[4]{ minX, maxX, maxX, minX };
+		const float cornerY[4]{ minY, minY, maxY, maxY };
+
+		// Inside is the side of the window center, forward can lie outside an off-center crop window
+		const Vector3 center{ (minX + maxX) / 2 * m_Right + (minY + maxY) / 2 * m_Up + m_Forward };
+
+		planes.resize(4);
+		for (int idx{}; idx < 4; ++idx)
+		{
+			const int nextIdx{ (idx + 1) % 4 };
+			const Vector3 corner{ cornerX[idx] * m_Right + cornerY[idx] * m_Up + m_Forward };
+			const Vector3 nextCorner{ cornerX[nextIdx] * m_Right + cornerY[nextIdx] * m_Up + m_Forward };
+
+			Vector3 normal{ Vector3::Cross(corner, nextCorner) };
+			if (Vector3::Dot(normal, center) < 0)
+			{
+				normal = -normal;
+			}
+			normal.Normalize();
+
+			planes[idx] = Plane{ m_Origin, normal };
+		}
+	}
+
+	void RayGenerator::BuildCameraTable()
+	{
+		const float fovAngle{ std::tan(m_FovAngle * TO_RADIANS / 2) };
+		const float aspectRatio{ float(m_FullWidth) / m_FullHeight };
+
+		// cx = ((2 * x / width) - 1) * aspectRatio * fov, cy = (1 - (2 * y / height)) * fov, of the full frame
+		m_ScaleX = 2 * aspectRatio * fovAngle / m_FullWidth;
+		m_OffsetX = -aspectRatio * fovAngle;
+		m_ScaleY = -2 * fovAngle / m_FullHeight;
+		m_OffsetY = fovAngle;
+
+		const size_t pixelCount{ static_cast<size_t>(m_Width) * m_Height };
+		m_CameraX.resize(pixelCount);
+		m_CameraY.resize(pixelCount);
+		m_CameraZ.resize(pixelCount);
+		m_WorldX.resize(pixelCount);
+		m_WorldY.resize(pixelCount);
+		m_WorldZ.resize(pixelCount);
+
+		for (int py{}; py < m_Height; ++py)
+		{
+			const float cy{ (m_RegionY + py + 0.5f) * m_ScaleY + m_OffsetY };
+
+			// cx from the pixel position instead of stepping along the row, steps drift on very wide frames
+			for (int px{}; px < m_Width; ++px)
+			{
+				const float cx{ (m_RegionX + px + 0.5f) * m_ScaleX + m_OffsetX };
+				const size_t pixelIdx{ static_cast<size_t>(px) + static_cast<size_t>(py) * m_Width };
+				const float invLength{ 1.f / std::sqrt(cx * cx + cy * cy + 1.f) };
+
+				m_CameraX[pixelIdx] = cx * invLength;
+				m_CameraY[pixelIdx] = cy * invLength;
+				m_CameraZ[pixelIdx] = invLength;
+			}
+		}
+	}
+
+	void RayGenerator::RotateTable()
+	{
+		// Rotation keeps the length, no normalize needed
+		const size_t pixelCount{ m_CameraX.size() };
+		size_t pixelIdx{};
+
+#ifdef RAYGENERATOR_SSE
+		const __m128 rightX{ _mm_set1_ps(m_Right.x) }, rightY{ _mm_set1_ps(m_Right.y) }, rightZ{ _mm_set1_ps(m_Right.z) };
+		const __m128 upX{ _mm_set1_ps(m_Up.x) }, upY{ _mm_set1_ps(m_Up.y) }, upZ{ _mm_set1_ps(m_Up.z) };
+		const __m128 forwardX{ _mm_set1_ps(m_Forward.x) }, forwardY{ _mm_set1_ps(m_Forward.y) }, forwardZ{ _mm_set1_ps(m_Forward.z) };
+
+		for (; pixelIdx + 4 <= pixelCount; pixelIdx += 4)
+		{
+			const __m128 cx{ _mm_loadu_ps(&m_CameraX[pixelIdx]) };
+			const __m128 cy{ _mm_loadu_ps(&m_CameraY[pixelIdx]) };
+			const __m128 cz{ _mm_loadu_ps(&m_CameraZ[pixelIdx]) };
+
+			_mm_storeu_ps(&m_WorldX[pixelIdx], _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, rightX), _mm_mul_ps(cy, upX)), _mm_mul_ps(cz, forwardX)));
+			_mm_storeu_ps(&m_WorldY[pixelIdx], _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, rightY), _mm_mul_ps(cy, upY)), _mm_mul_ps(cz, forwardY)));
+			_mm_storeu_ps(&m_WorldZ[pixelIdx], _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, rightZ), _mm_mul_ps(cy, upZ)), _mm_mul_ps(cz, forwardZ)));
+		}
+#endif
+
+		// Remainder (or everything without SSE)
+		for (; pixelIdx < pixelCount; ++pixelIdx)
+		{
+			const float cx{ m_CameraX[pixelIdx] };
+			const float cy{ m_CameraY[pixelIdx] };
+			const float cz{ m_CameraZ[pixelIdx] };
+
+			m_WorldX[pixelIdx] = cx * m_Right.x + cy * m_Up.x + cz * m_Forward.x;
+			m_WorldY[pixelIdx] = cx * m_Right.y + cy * m_Up.y + cz * m_Forward.y;
+			m_WorldZ[pixelIdx] = cx * m_Right.z + cy * m_Up.z + cz * m_Forward.z;
+		}
+	}
+}
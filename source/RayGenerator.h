@@ -0,0 +1,88 @@
+#pragma once
+#include <vector>
+
+#include "Math.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Forward Declarations
+	struct Camera;
+
+	//Primary ray directions of a camera, cached per pixel
+	class RayGenerator final
+	{
+	public:
+		RayGenerator() = default;
+		~RayGenerator() = default;
+
+		RayGenerator(const RayGenerator&) = delete;
+		RayGenerator(RayGenerator&&) noexcept = delete;
+		RayGenerator& operator=(const RayGenerator&) = delete;
+		RayGenerator& operator=(RayGenerator&&) noexcept = delete;
+
+		/**
+		 * \brief Call once per frame. Rebuilds the cameraSpace table only when fov or resolution changed,
+		 *		  rotates it to worldSpace only when the camera rotated.
+		 */
+		void Update(Camera& camera, int width, int height) { Update(camera, width, height, 0, 0, width, height); }
+		// Only the pixels of a crop window of a (larger) full frame get a table, projection of the full frame
+		void Update(Camera& camera, int fullWidth, int fullHeight, int x, int y, int width, int height);
+
+		// Pixel center ray, lookup in the worldSpace table (pixel relative to the crop window)
+		Ray GetPixelRay(int px, int py) const
+		{
+			const size_t pixelIdx{ static_cast<size_t>(px + (py * m_Width)) };
+			return Ray{ m_Origin, Vector3{ m_WorldX[pixelIdx], m_WorldY[pixelIdx], m_WorldZ[pixelIdx] } };
+		}
+		// Ray through any raster position of the crop window (jittered/sub-pixel samples)
+		Ray GetRay(float x, float y) const;
+		// Rays of a rectangle of pixels, row by row
+		void GenerateTile(int x0, int y0, int tileWidth, int tileHeight, std::vector<Ray>& rays) const;
+
+		// Projects a worldSpace point to raster coordinates of the crop window, false when behind the camera
+		bool Project(const Vector3& point, float& x, float& y) const;
+		// Side planes of the view frustum of the crop window, normals pointing inside
+		void GetFrustumPlanes(std::vector<Plane>& planes) const;
+
+		// Structure of arrays worldSpace directions, for packets
+		const float* GetDirectionsX() const { return m_WorldX.data(); }
+		const float* GetDirectionsY() const { return m_WorldY.data(); }
+		const float* GetDirectionsZ() const { return m_WorldZ.data(); }
+		const Vector3& GetOrigin() const { return m_Origin; }
+
+	private:
+		int m_FullWidth{};
+		int m_FullHeight{};
+		// Crop window, the tables hold m_Width * m_Height pixels
+		int m_RegionX{};
+		int m_RegionY{};
+		int m_Width{};
+		int m_Height{};
+		float m_FovAngle{ -1.f };
+
+		// Raster to cameraSpace: cx = x * scaleX + offsetX, cy = y * scaleY + offsetY
+		float m_ScaleX{};
+		float m_ScaleY{};
+		float m_OffsetX{};
+		float m_OffsetY{};
+
+		Vector3 m_Origin{};
+		Vector3 m_Right{};
+		Vector3 m_Up{};
+		Vector3 m_Forward{};
+
+		// Normalized cameraSpace directions of every pixel center
+		std::vector<float> m_CameraX{};
+		std::vector<float> m_CameraY{};
+		std::vector<float> m_CameraZ{};
+
+		// Same directions, rotated to worldSpace
+		std::vector<float> m_WorldX{};
+		std::vector<float> m_WorldY{};
+		std::vector<float> m_WorldZ{};
+
+		void BuildCameraTable();
+		void RotateTable();
+	};
+}
@@ -0,0 +1,125 @@
+//Standard includes
+#include <algorithm>
+
+//Project includes
+#include "RayQuery.h"
+#include "Scene.h"
+
+namespace dae {
+
+	void RayBuffer::Resize(size_t count)
+	{
+		originX.resize(count);
+		originY.resize(count);
+		originZ.resize(count);
+		directionX.resize(count);
+		directionY.resize(count);
+		directionZ.resize(count);
+		min.resize(count, 0.0001f);
+		max.resize(count, FLT_MAX);
+	}
+
+	void RayBuffer::Set(size_t rayIdx, const Ray& ray)
+	{
+		originX[rayIdx] = ray.origin.x;
+		originY[rayIdx] = ray.origin.y;
+		originZ[rayIdx] = ray.origin.z;
+		directionX[rayIdx] = ray.direction.x;
+		directionY[rayIdx] = ray.direction.y;
+		directionZ[rayIdx] = ray.direction.z;
+		min[rayIdx] = ray.min;
+		max[rayIdx] = ray.max;
+	}
+
+	void HitBuffer::Resize(size_t count)
+	{
+		t.resize(count);
+		positionX.resize(count);
+		positionY.resize(count);
+		positionZ.resize(count);
+		normalX.resize(count);
+		normalY.resize(count);
+		normalZ.resize(count);
+		primitiveId.resize(count);
+		materialIndex.resize(count);
+	}
+
+	RayQuery::RayQuery(const Scene* pScene, int threadCount) :
+		m_pScene(pScene)
+	{
+		SetThreadCount(threadCount);
+	}
+
+	void RayQuery::SetThreadCount(int threadCount)
+	{
+		m_ThreadPool.SetThreadCount(threadCount);
+	}
+
+	void RayQuery::TraceClosest(const RayBuffer& rays, HitBuffer& hits) const
+	{
+		hits.Resize(rays.GetCount());
+
+		ForEachChunk(rays.GetCount(), [&](size_t first, size_t last)
+			{
+				// Rays from one point (camera, picking, a probe) share the origin terms of spheres and planes
+				bool isSameOrigin{ true };
+				for (size_t rayIdx{ first + 1 }; rayIdx < last && isSameOrigin; ++rayIdx)
+				{
+					isSameOrigin = rays.originX[rayIdx] == rays.originX[first] && rays.originY[rayIdx] == rays.originY[first]
+						&& rays.originZ[rayIdx] == rays.originZ[first];
+				}
+
+				ViewTerms viewTerms{};
+				if (isSameOrigin)
+				{
+					m_pScene->UpdateOriginTerms(Vector3{ rays.originX[first], rays.originY[first], rays.originZ[first] }, viewTerms);
+				}
+
+				for (size_t rayIdx{ first }; rayIdx < last; ++rayIdx)
+				{
+					HitRecord closestHit{};
+					if (isSameOrigin)
+					{
+						m_pScene->GetClosestHitFromOrigin(rays.Get(rayIdx), closestHit, viewTerms);
+					}
+					else
+					{
+						m_pScene->GetClosestHit(rays.Get(rayIdx), closestHit);
+					}
+
+					hits.t[rayIdx] = closestHit.t;
+					hits.positionX[rayIdx] = closestHit.origin.x;
+					hits.positionY[rayIdx] = closestHit.origin.y;
+					hits.positionZ[rayIdx] = closestHit.origin.z;
+					hits.normalX[rayIdx] = closestHit.normal.x;
+					hits.normalY[rayIdx] = closestHit.normal.y;
+					hits.normalZ[rayIdx] = closestHit.normal.z;
+					hits.primitiveId[rayIdx] = closestHit.didHit ? closestHit.primitiveId : -1;
+					hits.materialIndex[rayIdx] = closestHit.materialIndex;
+				}
+			});
+	}
+
+	void RayQuery::TraceOcclusion(const RayBuffer& rays, std::vector<uint8_t>& occluded) const
+	{
+		occluded.resize(rays.GetCount());
+
+		ForEachChunk(rays.GetCount(), [&](size_t first, size_t last)
+			{
+				for (size_t rayIdx{ first }; rayIdx < last; ++rayIdx)
+				{
+					occluded[rayIdx] = m_pScene->DoesHit(rays.Get(rayIdx)) ? 1 : 0;
+				}
+			});
+	}
+
+	void RayQuery::ForEachChunk(size_t rayCount, const std::function<void(size_t, size_t)>& chunkJob) const
+	{
+		const size_t chunkCount{ (rayCount + m_ChunkSize - 1) / m_ChunkSize };
+		m_ThreadPool.ForEachJob(static_cast<int>(chunkCount), [&](int chunkIdx)
+			{
+				const size_t first{ static_cast<size_t>(chunkIdx) * m_ChunkSize };
+				chunkJob(first, std::min(first + m_ChunkSize, rayCount));
+			});
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Math.h"
+#include "DataTypes.h"
+#include "ThreadPool.h"
+
+namespace dae
+{
+	//Forward Declarations
+	class Scene;
+
+	// Structure of arrays rays, every array holds GetCount() entries
+	struct RayBuffer
+	{
+		std::vector<float> originX{};
+		std::vector<float> originY{};
+		std::vector<float> originZ{};
+		std::vector<float> directionX{};
+		std::vector<float> directionY{};
+		std::vector<float> directionZ{};
+		std::vector<float> min{};
+		std::vector<float> max{};
+
+		size_t GetCount() const { return originX.size(); }
+		void Resize(size_t count);
+		void Set(size_t rayIdx, const Ray& ray);
+		Ray Get(size_t rayIdx) const
+		{
+			return Ray{ Vector3{ originX[rayIdx], originY[rayIdx], originZ[rayIdx] },
+						Vector3{ directionX[rayIdx], directionY[rayIdx], directionZ[rayIdx] }, min[rayIdx], max[rayIdx] };
+		}
+	};
+
+	// Structure of arrays closest hits, primitiveId -1 when the ray hit nothing
+	struct HitBuffer
+	{
+		std::vector<float> t{};
+		std::vector<float> positionX{};
+		std::vector<float> positionY{};
+		std::vector<float> positionZ{};
+		std::vector<float> normalX{};
+		std::vector<float> normalY{};
+		std::vector<float> normalZ{};
+		std::vector<int> primitiveId{};
+		std::vector<unsigned char> materialIndex{};
+
+		size_t GetCount() const { return t.size(); }
+		void Resize(size_t count);
+	};
+
+	//Batch ray queries against a scene, without a renderer or window. The scene has to stay unchanged during a call.
+	class RayQuery final
+	{
+	public:
+		RayQuery(const Scene* pScene, int threadCount = 1);
+		~RayQuery() = default;
+
+		RayQuery(const RayQuery&) = delete;
+		RayQuery(RayQuery&&) noexcept = delete;
+		RayQuery& operator=(const RayQuery&) = delete;
+		RayQuery& operator=(RayQuery&&) noexcept = delete;
+
+		// Closest hit of every ray, same results as Scene::GetClosestHit
+		void TraceClosest(const RayBuffer& rays, HitBuffer& hits) const;
+		// 1 when anything lies between min and max of the ray, same results as Scene::DoesHit
+		void TraceOcclusion(const RayBuffer& rays, std::vector<uint8_t>& occluded) const;
+
+		void SetThreadCount(int threadCount);
+		int GetThreadCount() const { return m_ThreadPool.GetThreadCount(); }
+
+	private:
+		const Scene* m_pScene{};
+		mutable ThreadPool m_ThreadPool{}; // Kept between queries, the queries themselves don't change the RayQuery
+
+		// Rays per job, small batches stay on the calling thread
+		static constexpr size_t m_ChunkSize{ 256 };
+
+		void ForEachChunk(size_t rayCount, const std::function<void(size_t, size_t)>& chunkJob) const;
+	};
+}
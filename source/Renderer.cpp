@@ -1,6 +1,15 @@
 //External includes
+#ifndef RAYTRACER_HEADLESS
 #include "SDL.h"
 #include "SDL_surface.h"
+#endif
+
+//Standard includes
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <thread>
 
 //Project includes
 #include "Renderer.h"
@@ -9,9 +18,11 @@
 #include "Material.h"
 #include "Scene.h"
 #include "Utils.h"
+#include "FrameStream.h"
 
 using namespace dae;
 
+#ifndef RAYTRACER_HEADLESS
 Renderer::Renderer(SDL_Window * pWindow) :
 	m_pWindow(pWindow),
 	m_pBuffer(SDL_GetWindowSurface(pWindow))
@@ -19,76 +30,1075 @@ Renderer::Renderer(SDL_Window * pWindow) :
 	//Initialize
 	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
 	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+
+	m_HDRBuffer.resize(static_cast<size_t>(m_Width * m_Height));
+	m_ToneMapper.SetPixelFormat(m_pBuffer->format);
+	SetThreadCount(static_cast<int>(std::thread::hardware_concurrency()));
+	ResetCropWindow();
+}
+#endif
+
+Renderer::Renderer(int width, int height) :
+	m_Width(width),
+	m_Height(height)
+{
+	// Offscreen, pixels are 0xAARRGGBB
+	m_OffscreenPixels.resize(static_cast<size_t>(m_Width * m_Height));
+	m_pBufferPixels = m_OffscreenPixels.data();
+
+	m_HDRBuffer.resize(static_cast<size_t>(m_Width * m_Height));
+	m_ToneMapper.SetChannelLayout(16, 8, 0, 0xFF000000);
+	SetThreadCount(static_cast<int>(std::thread::hardware_concurrency()));
+	ResetCropWindow();
+}
+
+bool Renderer::Render(Scene* pScene)
+{
+	const uint64_t stateHash{ HashCombine(HashCombine(pScene->GetStateHash(), m_SettingsVersion), m_ShadingVersion) };
+	const bool hasChanged{ stateHash != m_LastStateHash };
+	m_LastStateHash = stateHash;
+
+	// Kernels, ray directions and the scene terms set up below only depend on what the state hash covers,
+	// when it didn't change they're still those of the last traced frame
+	const bool canAccumulate{ m_ProgressiveEnabled && !m_AdaptiveAAEnabled && !m_DistributedEnabled && !m_SubsamplingEnabled };
+	if (!hasChanged)
+	{
+		// Nothing changed, refine the previous frame instead of tracing it again
+		if (canAccumulate && m_AccumulatedFrames > 0 && m_AccumulatedFrames < m_MaxAccumulatedFrames)
+		{
+			RenderProgressive(pScene);
+			return true;
+		}
+
+		// Only the tone mapping changed, no need to trace
+		if (m_ToneMapVersion != m_LastToneMapVersion)
+		{
+			Present();
+			return true;
+		}
+
+		// Same image as last frame, don't trace or present
+		return false;
+	}
+
+	// Pick the kernels for the current lighting mode and shadow setting once for the whole frame
+	SelectKernels();
+
+	// Primary ray directions, only rebuilt or rotated when the camera asks for it
+	m_RayGenerator.Update(pScene->GetCamera(), m_FullWidth, m_FullHeight, m_CropX, m_CropY, m_Width, m_Height);
+	if (m_OriginTermsEnabled)
+	{
+		pScene->UpdateOriginTerms(m_RayGenerator.GetOrigin());
+
+		// Shadow rays of point lights leave the light, cull what can't cast a visible shadow
+		if (m_ShadowsEnabled)
+		{
+			m_RayGenerator.GetFrustumPlanes(m_FrustumPlanes);
+			pScene->UpdateLightTerms(m_RayGenerator.GetOrigin(), m_FrustumPlanes);
+		}
+	}
+
+	if (m_DistributedEnabled)
+	{
+		m_HasGBuffer = false;
+		RenderDistributed(pScene);
+		return true;
+	}
+
+	if (m_SubsamplingEnabled)
+	{
+		m_HasGBuffer = false;
+		RenderSubsampled(pScene);
+		return true;
+	}
+
+	// Only lights or materials changed, shade the cached visible points again
+	const bool canCache{ !m_AdaptiveAAEnabled };
+	if (canCache && m_ReshadeEnabled && RenderReshade(pScene, canAccumulate))
+	{
+		return true;
+	}
+
+	// Only meshes moved, retrace the regions they touch
+	if (canCache && m_IncrementalEnabled && RenderIncremental(pScene, canAccumulate))
+	{
+		return true;
+	}
+
+	if (canAccumulate)
+	{
+		m_AccumulationBuffer.resize(static_cast<size_t>(m_Width * m_Height));
+	}
+
+	if (canCache)
+	{
+		const size_t pixelCount{ static_cast<size_t>(m_Width * m_Height) };
+		m_GBufferHits.resize(pixelCount);
+		m_GBufferViewRays.resize(pixelCount);
+		m_GBufferShadowMasks.resize(pixelCount);
+	}
+
+	if (m_AdaptiveAAEnabled)
+	{
+		const size_t pixelCount{ static_cast<size_t>(m_Width * m_Height) };
+		m_SampleColors.resize(pixelCount);
+		m_SamplePrimitiveIds.resize(pixelCount);
+		m_SampleMaterials.resize(pixelCount);
+	}
+
+	// Every row is independent, spread them over the render threads
+	ForEachRow([&](int py)
+		{
+			for (int px{}; px < m_Width; ++px)
+			{
+				// Show results with color
+				const Ray viewRay{ m_RayGenerator.GetPixelRay(px, py) };
+				HitRecord closestHit{};
+				uint32_t shadowMask{};
+				const ColorRGB finalColor{ ShadeViewRay(pScene, viewRay, closestHit, &shadowMask) };
+
+				// Keep first sample for edge detection
+				if (m_AdaptiveAAEnabled)
+				{
+					const int pixelIdx{ px + (py * m_Width) };
+					m_SampleColors[pixelIdx] = finalColor;
+					m_SamplePrimitiveIds[pixelIdx] = closestHit.didHit ? closestHit.primitiveId : -1;
+					m_SampleMaterials[pixelIdx] = closestHit.materialIndex;
+				}
+
+				// First sample of the accumulation
+				if (canAccumulate)
+				{
+					m_AccumulationBuffer[px + (py * m_Width)] = finalColor;
+				}
+
+				// Visible points, reused when only the lighting or some meshes change
+				if (canCache)
+				{
+					const int pixelIdx{ px + (py * m_Width) };
+					m_GBufferHits[pixelIdx] = closestHit;
+					m_GBufferViewRays[pixelIdx] = viewRay;
+					m_GBufferShadowMasks[pixelIdx] = shadowMask;
+				}
+
+				m_HDRBuffer[px + (py * m_Width)] = finalColor;
+			}
+		});
+
+	// Supersample the edges only
+	if (m_AdaptiveAAEnabled)
+	{
+		RefineEdges(pScene);
+	}
+
+	m_AccumulatedFrames = canAccumulate ? 1 : 0;
+
+	if (canCache)
+	{
+		StoreGBufferState(pScene);
+		m_GBufferHasShadowMasks = m_ShadowsEnabled && pScene->GetLights().size() <= m_MaxShadowMaskLights;
+		m_RetracedTileFraction = 1.f;
+	}
+	else
+	{
+		m_HasGBuffer = false;
+	}
+
+	//@END
+	//Tone map and present
+	Present();
+	return true;
+}
+
+void Renderer::SelectKernels()
+{
+	switch (m_CurrentLightMode)
+	{
+	case dae::Renderer::LightingMode::ObservedArea:
+		SelectKernels<LightingMode::ObservedArea>();
+		break;
+	case dae::Renderer::LightingMode::Radiance:
+		SelectKernels<LightingMode::Radiance>();
+		break;
+	case dae::Renderer::LightingMode::BRDF:
+		SelectKernels<LightingMode::BRDF>();
+		break;
+	case dae::Renderer::LightingMode::Combined:
+		SelectKernels<LightingMode::Combined>();
+		break;
+	}
+}
+
+template<Renderer::LightingMode Mode>
+void Renderer::SelectKernels()
+{
+	if (m_ShadowsEnabled)
+	{
+		m_pShadeViewRayKernel = &Renderer::ShadeViewRayKernel<Mode, true>;
+		m_pShadeHitKernel = &Renderer::ShadeHitKernel<Mode, true>;
+		m_pShadeFragmentKernel = &Renderer::ShadeFragmentKernel<Mode, true>;
+	}
+	else
+	{
+		m_pShadeViewRayKernel = &Renderer::ShadeViewRayKernel<Mode, false>;
+		m_pShadeHitKernel = &Renderer::ShadeHitKernel<Mode, false>;
+		m_pShadeFragmentKernel = &Renderer::ShadeFragmentKernel<Mode, false>;
+	}
+}
+
+ColorRGB Renderer::ShadeViewRay(Scene* pScene, const Ray& viewRay, HitRecord& closestHit, uint32_t* pShadowMask) const
+{
+	return (this->*m_pShadeViewRayKernel)(pScene, pScene->GetViewTerms(), viewRay, closestHit, pShadowMask);
+}
+
+template<Renderer::LightingMode Mode, bool ShadowsEnabled>
+ColorRGB Renderer::ShadeViewRayKernel(Scene* pScene, const ViewTerms& viewTerms, const Ray& viewRay, HitRecord& closestHit, uint32_t* pShadowMask) const
+{
+	if (m_OriginTermsEnabled)
+	{
+		pScene->GetClosestHitFromOrigin(viewRay, closestHit, viewTerms);
+	}
+	else
+	{
+		pScene->GetClosestHit(viewRay, closestHit);
+	}
+	if (!closestHit.didHit)
+	{
+		return {};
+	}
+
+	uint32_t shadowMask{};
+	const ColorRGB finalColor{ ShadeLightsKernel<Mode, ShadowsEnabled, true>(pScene, viewTerms, closestHit, viewRay, shadowMask) };
+
+	if (pShadowMask)
+	{
+		*pShadowMask = shadowMask;
+	}
+
+	return finalColor;
+}
+
+template<Renderer::LightingMode Mode, bool ShadowsEnabled>
+ColorRGB Renderer::ShadeHitKernel(Scene* pScene, const HitRecord& closestHit, const Ray& viewRay, uint32_t shadowMask) const
+{
+	// Occlusion comes from the G-buffer, no rays traced
+	return ShadeLightsKernel<Mode, ShadowsEnabled, false>(pScene, pScene->GetViewTerms(), closestHit, viewRay, shadowMask);
+}
+
+template<Renderer::LightingMode Mode, bool ShadowsEnabled>
+ColorRGB Renderer::ShadeFragmentKernel(Scene* pScene, const HitRecord& closestHit, const Ray& viewRay, const Ray* pShadowRays, const uint8_t* pOcclusion) const
+{
+	// Shadow rays and their occlusion come from the partitions, no rays traced
+	auto& materials = pScene->GetMaterials();
+	auto& lights = pScene->GetLights();
+
+	ColorRGB finalColor{};
+	for (size_t idx{}; idx < lights.size(); idx++)
+	{
+		// Empty slot: outside the view ray's boundaries or facing away
+		const Ray& hitToLight{ pShadowRays[idx] };
+		if (!(hitToLight.max > hitToLight.min))
+		{
+			continue;
+		}
+
+		if constexpr (ShadowsEnabled)
+		{
+			if (pOcclusion[idx]) continue;
+		}
+
+		const float observedArea{ Vector3::Dot(closestHit.normal, hitToLight.direction) };
+		finalColor += ShadeLightKernel<Mode>(lights[idx], materials[closestHit.materialIndex], closestHit, hitToLight.direction, viewRay.direction, observedArea);
+	}
+
+	// Linear HDR, tone mapped when presenting
+	return finalColor;
+}
+
+template<Renderer::LightingMode Mode>
+ColorRGB Renderer::ShadeLightKernel(const Light& light, Material* pMaterial, const HitRecord& closestHit, const Vector3& lightDirection,
+	const Vector3& viewDirection, float observedArea)
+{
+	if constexpr (Mode == LightingMode::ObservedArea)
+	{
+		return observedArea * ColorRGB{ 1,1,1 };
+	}
+	else if constexpr (Mode == LightingMode::Radiance)
+	{
+		return LightUtils::GetRadiance(light, closestHit.origin);
+	}
+	else if constexpr (Mode == LightingMode::BRDF)
+	{
+		return pMaterial->Shade(closestHit, lightDirection, viewDirection);
+	}
+	else
+	{
+		const ColorRGB radiance{ LightUtils::GetRadiance(light, closestHit.origin) };
+		const ColorRGB BRDF{ pMaterial->Shade(closestHit, lightDirection, viewDirection) };
+
+		return radiance * BRDF * observedArea;
+	}
 }
 
-void Renderer::Render(Scene* pScene) const
+template<Renderer::LightingMode Mode, bool ShadowsEnabled, bool TraceShadows>
+ColorRGB Renderer::ShadeLightsKernel(Scene* pScene, const ViewTerms& viewTerms, const HitRecord& closestHit, const Ray& viewRay, uint32_t& shadowMask) const
 {
-	Camera& camera = pScene->GetCamera();
 	auto& materials = pScene->GetMaterials();
 	auto& lights = pScene->GetLights();
 
+	ColorRGB finalColor{};
 
-	Vector3 rayDirection{};
-	rayDirection.z = camera.forward.z;
-	float cx{};
-	float cy{};
-	const float aspectRatio{ float(m_Width) / m_Height };
+	// HitToLight Variables
+	Ray hitToLight{};
+	hitToLight.origin = closestHit.origin;
 
-	for (int px{}; px < m_Width; ++px)
+	float hitToLightDirectionMagnitude{};
+
+	// Check all lighting
+	for (size_t idx{}; idx < lights.size(); idx++)
 	{
-		for (int py{}; py < m_Height; ++py)
+		// Init HitToLight Variables
+		hitToLight.direction = LightUtils::GetDirectionToLight(lights[idx], closestHit.origin);
+		hitToLightDirectionMagnitude = hitToLight.direction.Normalize();
+
+		hitToLight.max = hitToLightDirectionMagnitude;
+
+		// If !insideBoundaries, continue
+		const bool isInsideBoundaries{ viewRay.min < hitToLightDirectionMagnitude
+										&& hitToLightDirectionMagnitude < viewRay.max };
+		if (!isInsideBoundaries)
+		{
+			continue;
+		}
+
+		// Calculate ObservedArea --> lighted area
+		const float observedArea{ Vector3::Dot(closestHit.normal, hitToLight.direction) };
+		// Check for negative values
+		if (observedArea < 0)
 		{
-			const float pxc{ px + 0.5f };
-			const float pyc{ py + 0.5f };
+			continue;
+		}
 
-			const float fovAngle{ std::tanf(camera.fovAngle * TO_RADIANS / 2)};
+		// If something obstructs, continue (no shadow rays at all when shadows are off)
+		if constexpr (ShadowsEnabled)
+		{
+			if constexpr (TraceShadows)
+			{
+				const bool isOccluded{ m_OriginTermsEnabled ? pScene->DoesHitLight(idx, hitToLight, viewTerms) : pScene->DoesHit(hitToLight) };
+				if (isOccluded)
+				{
+					// Lights past the mask are still shadowed, the G-buffer just can't keep them (no reshading then)
+					if (idx < m_MaxShadowMaskLights)
+					{
+						shadowMask |= 1u << idx;
+					}
+					continue;
+				}
+			}
+			else
+			{
+				assert(idx < m_MaxShadowMaskLights && "Reshading needs a shadow mask bit per light");
+				if (shadowMask & (1u << idx)) continue;
+			}
+		}
 
-			const Matrix cameraToWorld{ camera.CalculateCameraToWorld() };
+		// Calculate finalLightingColor
+		finalColor += ShadeLightKernel<Mode>(lights[idx], materials[closestHit.materialIndex], closestHit, hitToLight.direction, viewRay.direction, observedArea);
+	}
 
-			// Calculate rasterSpace to cameraSpace
-			cx = ((2 * pxc / m_Width) - 1) * (aspectRatio * fovAngle);
-			cy = float(1 - (2 * pyc / m_Height)) * fovAngle;
+	// Linear HDR, tone mapped when presenting
+	return finalColor;
+}
 
-			// Calculate rayDirectionVector
-			rayDirection = cx * Vector3::UnitX + cy * Vector3::UnitY + Vector3::UnitZ;
-			rayDirection.Normalize();
+void Renderer::RefineEdges(Scene* pScene)
+{
+	// Rotated grid, first sample (pixel center) is already traced
+	constexpr int extraSampleCount{ 4 };
+	constexpr float sampleOffsets[extraSampleCount][2]
+	{
+		{ .375f, .125f },
+		{ .875f, .375f },
+		{ .125f, .625f },
+		{ .625f, .875f }
+	};
 
-			// Transform rayDirection
-			rayDirection = cameraToWorld.TransformVector(rayDirection);
+	// Detect pixels that differ from a neighbour, each row only writes its own flags
+	m_RefinePixels.resize(m_SampleColors.size());
+	auto differs = [this](int a, int b)
+	{
+		return m_SamplePrimitiveIds[a] != m_SamplePrimitiveIds[b]
+			|| m_SampleMaterials[a] != m_SampleMaterials[b]
+			|| std::abs(m_SampleColors[a].GetLuminance() - m_SampleColors[b].GetLuminance()) > m_AAThreshold;
+	};
 
-			// Show results with color
-			const Ray viewRay{ camera.origin, rayDirection };
-			ColorRGB finalColor{};
-			HitRecord closestHit{};
+	ForEachRow([&](int py)
+		{
+			for (int px{}; px < m_Width; ++px)
+			{
+				const int pixelIdx{ px + (py * m_Width) };
+				m_RefinePixels[pixelIdx] = (px > 0 && differs(pixelIdx, pixelIdx - 1))
+					|| (px + 1 < m_Width && differs(pixelIdx, pixelIdx + 1))
+					|| (py > 0 && differs(pixelIdx, pixelIdx - m_Width))
+					|| (py + 1 < m_Height && differs(pixelIdx, pixelIdx + m_Width));
+			}
+		});
 
-			pScene->GetClosestHit(viewRay, closestHit);
-			if (closestHit.didHit)
+	// Add samples only there
+	std::atomic<int> refinedCount{};
+	ForEachRow([&](int py)
+		{
+			int rowRefinedCount{};
+			for (int px{}; px < m_Width; ++px)
 			{
-				// HitToLight Variables
-				Ray hitToLight{};
-				hitToLight.origin = closestHit.origin;
+				const int pixelIdx{ px + (py * m_Width) };
+				if (!m_RefinePixels[pixelIdx])
+				{
+					continue;
+				}
+
+				ColorRGB finalColor{ m_SampleColors[pixelIdx] };
+				for (const auto& offset : sampleOffsets)
+				{
+					HitRecord closestHit{};
+					finalColor += ShadeViewRay(pScene, m_RayGenerator.GetRay(px + offset[0], py + offset[1]), closestHit);
+				}
+				finalColor /= float(extraSampleCount + 1);
+
+				m_HDRBuffer[pixelIdx] = finalColor;
+
+				++rowRefinedCount;
+			}
+			refinedCount += rowRefinedCount;
+		});
+
+	m_RefinedPixelFraction = float(refinedCount) / (m_Width * m_Height);
+}
+
+bool Renderer::RenderIncremental(Scene* pScene, bool canAccumulate)
+{
+	const SceneVersions versions{ pScene->GetVersions() };
+	const auto& meshes{ pScene->GetTriangleMeshGeometries() };
+	const auto& lights{ pScene->GetLights() };
+
+	// Only possible when the meshes are the one thing that changed since the last frame
+	const bool onlyMeshesChanged{ versions.camera == m_LastVersions.camera
+									&& versions.spheres == m_LastVersions.spheres
+									&& versions.planes == m_LastVersions.planes
+									&& versions.lights == m_LastVersions.lights
+									&& versions.lightColors == m_LastVersions.lightColors
+									&& versions.materials == m_LastVersions.materials
+									&& m_SettingsVersion == m_LastSettingsVersion
+									&& m_ShadingVersion == m_LastShadingVersion
+									&& meshes.size() == m_LastMeshBounds.size() };
 
-				Vector3 hitToLightDirection{};
-				float hitToLightDirectionMagnitude{};
+	// Accumulated pixels have more samples than the retraced ones would get
+	if (!m_HasGBuffer || !onlyMeshesChanged || m_AccumulatedFrames > 1)
+	{
+		return false;
+	}
+
+	// Old and new bounds of everything that moved
+	m_ChangedBounds.clear();
+	for (size_t idx{}; idx < meshes.size(); ++idx)
+	{
+		if (meshes[idx].version != m_LastMeshBounds[idx].version)
+		{
+			m_ChangedBounds.push_back({ m_LastMeshBounds[idx].minAABB, m_LastMeshBounds[idx].maxAABB });
+			m_ChangedBounds.push_back({ meshes[idx].transformedMinAABB, meshes[idx].transformedMaxAABB });
+		}
+	}
 
-				// Shadow Variables
-				bool isOccluded{ false };
+	const int tileCountX{ (m_Width + m_TileSize - 1) / m_TileSize };
+	const int tileCountY{ (m_Height + m_TileSize - 1) / m_TileSize };
+	m_DirtyTiles.assign(static_cast<size_t>(tileCountX * tileCountY), 0);
 
-				// Lighting Variables
-				ColorRGB radiance{};
-				ColorRGB BRDF{};
+	auto markScreenRect = [&](int minX, int minY, int maxX, int maxY)
+	{
+		minX = std::clamp(minX, 0, m_Width - 1) / m_TileSize;
+		maxX = std::clamp(maxX, 0, m_Width - 1) / m_TileSize;
+		minY = std::clamp(minY, 0, m_Height - 1) / m_TileSize;
+		maxY = std::clamp(maxY, 0, m_Height - 1) / m_TileSize;
 
-				// Check all lighting
-				for (size_t idx{}; idx < lights.size(); idx++)
+		for (int tileY{ minY }; tileY <= maxY; ++tileY)
+		{
+			for (int tileX{ minX }; tileX <= maxX; ++tileX)
+			{
+				m_DirtyTiles[tileX + (tileY * tileCountX)] = 1;
+			}
+		}
+	};
+
+	// Primary visibility: screen bounds of the projected boxes
+	for (const auto& bounds : m_ChangedBounds)
+	{
+		float minX{ FLT_MAX }, minY{ FLT_MAX };
+		float maxX{ -FLT_MAX }, maxY{ -FLT_MAX };
+		bool isBehindCamera{ false };
+
+		for (int cornerIdx{}; cornerIdx < 8 && !isBehindCamera; ++cornerIdx)
+		{
+			const Vector3 corner{ (cornerIdx & 1) ? bounds.second.x : bounds.first.x,
+								  (cornerIdx & 2) ? bounds.second.y : bounds.first.y,
+								  (cornerIdx & 4) ? bounds.second.z : bounds.first.z };
+
+			// WorldSpace to rasterSpace
+			float x{}, y{};
+			if (!m_RayGenerator.Project(corner, x, y))
+			{
+				isBehindCamera = true;
+				break;
+			}
+
+			minX = std::min(minX, x);
+			minY = std::min(minY, y);
+			maxX = std::max(maxX, x);
+			maxY = std::max(maxY, y);
+		}
+
+		// Can't project, be conservative
+		if (isBehindCamera)
+		{
+			markScreenRect(0, 0, m_Width - 1, m_Height - 1);
+			break;
+		}
+
+		// Completely off-screen
+		if (maxX < 0 || maxY < 0 || minX >= m_Width || minY >= m_Height)
+		{
+			continue;
+		}
+
+		markScreenRect(int(minX) - 1, int(minY) - 1, int(maxX) + 1, int(maxY) + 1);
+	}
+
+	// Shadow volumes: visible points whose path to a light crosses one of the boxes, each tile only sets its own flag
+	ForEachJob(tileCountX * tileCountY, [&](int tileIdx)
+		{
+			if (m_DirtyTiles[tileIdx])
+			{
+				return;
+			}
+
+			const int tileX{ tileIdx % tileCountX };
+			const int tileY{ tileIdx / tileCountX };
+			const int maxX{ std::min((tileX + 1) * m_TileSize, m_Width) };
+			const int maxY{ std::min((tileY + 1) * m_TileSize, m_Height) };
+			for (int py{ tileY * m_TileSize }; py < maxY && !m_DirtyTiles[tileIdx]; ++py)
+			{
+				for (int px{ tileX * m_TileSize }; px < maxX && !m_DirtyTiles[tileIdx]; ++px)
 				{
-					// Init HitToLight Variables
-					hitToLightDirection = LightUtils::GetDirectionToLight(lights[idx], closestHit.origin);
-					hitToLightDirectionMagnitude = hitToLightDirection.Magnitude();
+					const HitRecord& primaryHit{ m_GBufferHits[px + (py * m_Width)] };
+					if (!primaryHit.didHit)
+					{
+						continue;
+					}
 
-					hitToLight.direction = hitToLightDirection;
-					hitToLight.direction.Normalize();
+					for (size_t lightIdx{}; lightIdx < lights.size() && !m_DirtyTiles[tileIdx]; ++lightIdx)
+					{
+						Ray hitToLight{};
+						hitToLight.origin = primaryHit.origin;
+						if (lights[lightIdx].type == LightType::Directional)
+						{
+							hitToLight.direction = -lights[lightIdx].direction.Normalized();
+						}
+						else
+						{
+							hitToLight.direction = LightUtils::GetDirectionToLight(lights[lightIdx], primaryHit.origin);
+							hitToLight.max = hitToLight.direction.Normalize();
+						}
 
-					hitToLight.max = hitToLightDirectionMagnitude;
+						for (const auto& bounds : m_ChangedBounds)
+						{
+							if (GeometryUtils::HitTest_AABB(bounds.first, bounds.second, hitToLight))
+							{
+								m_DirtyTiles[tileIdx] = 1;
+								break;
+							}
+						}
+					}
+				}
+			}
+		});
+
+	// Retrace the dirty tiles only
+	m_DirtyTileIndices.clear();
+	for (int tileIdx{}; tileIdx < tileCountX * tileCountY; ++tileIdx)
+	{
+		if (m_DirtyTiles[tileIdx])
+		{
+			m_DirtyTileIndices.push_back(tileIdx);
+		}
+	}
+	const int dirtyTileCount{ static_cast<int>(m_DirtyTileIndices.size()) };
+
+	ForEachJob(dirtyTileCount, [&](int jobIdx)
+		{
+			const int tileX{ m_DirtyTileIndices[jobIdx] % tileCountX };
+			const int tileY{ m_DirtyTileIndices[jobIdx] / tileCountX };
+			const int maxX{ std::min((tileX + 1) * m_TileSize, m_Width) };
+			const int maxY{ std::min((tileY + 1) * m_TileSize, m_Height) };
+			for (int py{ tileY * m_TileSize }; py < maxY; ++py)
+			{
+				for (int px{ tileX * m_TileSize }; px < maxX; ++px)
+				{
+					const int pixelIdx{ px + (py * m_Width) };
+
+					const Ray viewRay{ m_RayGenerator.GetPixelRay(px, py) };
+
+					HitRecord closestHit{};
+					uint32_t shadowMask{};
+					const ColorRGB finalColor{ ShadeViewRay(pScene, viewRay, closestHit, &shadowMask) };
+
+					m_GBufferHits[pixelIdx] = closestHit;
+					m_GBufferViewRays[pixelIdx] = viewRay;
+					m_GBufferShadowMasks[pixelIdx] = shadowMask;
+
+					if (canAccumulate)
+					{
+						m_AccumulationBuffer[pixelIdx] = finalColor;
+					}
+
+					m_HDRBuffer[pixelIdx] = finalColor;
+				}
+			}
+		});
+
+	// Present the dirty tiles, neighbours on the same tile row are merged into one rectangle
+	std::vector<PixelRect> dirtyRects{};
+	for (int tileY{}; tileY < tileCountY; ++tileY)
+	{
+		for (int tileX{}; tileX < tileCountX; ++tileX)
+		{
+			if (!m_DirtyTiles[tileX + (tileY * tileCountX)])
+			{
+				continue;
+			}
+
+			const int startTileX{ tileX };
+			while (tileX + 1 < tileCountX && m_DirtyTiles[(tileX + 1) + (tileY * tileCountX)])
+			{
+				++tileX;
+			}
+
+			PixelRect rect{};
+			rect.x = startTileX * m_TileSize;
+			rect.y = tileY * m_TileSize;
+			rect.width = std::min((tileX + 1) * m_TileSize, m_Width) - rect.x;
+			rect.height = std::min((tileY + 1) * m_TileSize, m_Height) - rect.y;
+			dirtyRects.push_back(rect);
+		}
+	}
+
+	if (m_ToneMapVersion != m_LastToneMapVersion)
+	{
+		// Tone mapping changed as well, the whole frame has to be presented again
+		Present();
+	}
+	else if (!dirtyRects.empty())
+	{
+		PresentRects(dirtyRects);
+	}
+
+	m_RetracedTileFraction = float(dirtyTileCount) / (tileCountX * tileCountY);
+	m_AccumulatedFrames = canAccumulate ? 1 : 0;
+
+	StoreGBufferState(pScene);
+	m_GBufferHasShadowMasks = m_GBufferHasShadowMasks && m_ShadowsEnabled;
+	return true;
+}
+
+bool Renderer::RenderReshade(Scene* pScene, bool canAccumulate)
+{
+	const SceneVersions versions{ pScene->GetVersions() };
+	const auto& meshes{ pScene->GetTriangleMeshGeometries() };
+
+	// Meshes are compared on their own versions, scenes bump their mesh version every Update whether a mesh moved or not.
+	// A mesh that did move changes the visible points, so this never runs while one is animated: RenderIncremental takes those frames
+	bool meshesUnchanged{ meshes.size() == m_LastMeshBounds.size() };
+	for (size_t idx{}; idx < meshes.size() && meshesUnchanged; ++idx)
+	{
+		meshesUnchanged = meshes[idx].version == m_LastMeshBounds[idx].version;
+	}
+
+	// Only possible when the visible points and their shadow rays are still the same
+	const bool onlyShadingChanged{ versions.camera == m_LastVersions.camera
+									&& versions.spheres == m_LastVersions.spheres
+									&& versions.planes == m_LastVersions.planes
+									&& meshesUnchanged
+									&& versions.lights == m_LastVersions.lights
+									&& m_SettingsVersion == m_LastSettingsVersion };
+
+	// Shadow masks are only traced while shadows are enabled
+	if (!m_HasGBuffer || !onlyShadingChanged || (m_ShadowsEnabled && !m_GBufferHasShadowMasks))
+	{
+		return false;
+	}
+
+	ForEachRow([&](int py)
+		{
+			for (int pixelIdx{ py * m_Width }; pixelIdx < (py + 1) * m_Width; ++pixelIdx)
+			{
+				const HitRecord& closestHit{ m_GBufferHits[pixelIdx] };
+
+				ColorRGB finalColor{};
+				if (closestHit.didHit)
+				{
+					finalColor = ShadeHit(pScene, closestHit, m_GBufferViewRays[pixelIdx], m_GBufferShadowMasks[pixelIdx]);
+				}
+
+				if (canAccumulate)
+				{
+					m_AccumulationBuffer[pixelIdx] = finalColor;
+				}
+
+				m_HDRBuffer[pixelIdx] = finalColor;
+			}
+		});
+
+	m_AccumulatedFrames = canAccumulate ? 1 : 0;
+	StoreGBufferState(pScene);
+
+	//Tone map and present
+	Present();
+	return true;
+}
+
+void Renderer::StoreGBufferState(Scene* pScene)
+{
+	const auto& meshes{ pScene->GetTriangleMeshGeometries() };
+
+	m_LastVersions = pScene->GetVersions();
+	m_LastSettingsVersion = m_SettingsVersion;
+	m_LastShadingVersion = m_ShadingVersion;
+
+	m_LastMeshBounds.resize(meshes.size());
+	for (size_t idx{}; idx < meshes.size(); ++idx)
+	{
+		m_LastMeshBounds[idx].version = meshes[idx].version;
+		m_LastMeshBounds[idx].minAABB = meshes[idx].transformedMinAABB;
+		m_LastMeshBounds[idx].maxAABB = meshes[idx].transformedMaxAABB;
+	}
+
+	m_HasGBuffer = true;
+}
+
+void Renderer::RenderProgressive(Scene* pScene)
+{
+	// Same sub-pixel offset for every pixel of this frame, Halton(2,3) so the samples spread evenly
+	const float jitterX{ Halton(m_AccumulatedFrames, 2) };
+	const float jitterY{ Halton(m_AccumulatedFrames, 3) };
+
+	++m_AccumulatedFrames;
+	const float sampleWeight{ 1.f / m_AccumulatedFrames };
+
+	ForEachRow([&](int py)
+		{
+			for (int px{}; px < m_Width; ++px)
+			{
+				const int pixelIdx{ px + (py * m_Width) };
+
+				HitRecord closestHit{};
+				m_AccumulationBuffer[pixelIdx] += ShadeViewRay(pScene, m_RayGenerator.GetRay(px + jitterX, py + jitterY), closestHit);
+
+				const ColorRGB finalColor{ m_AccumulationBuffer[pixelIdx] * sampleWeight };
+				m_HDRBuffer[pixelIdx] = finalColor;
+			}
+		});
+
+	//Tone map and present
+	Present();
+}
+
+void Renderer::RenderSubsampled(Scene* pScene)
+{
+	const size_t pixelCount{ static_cast<size_t>(m_Width * m_Height) };
+	m_SampleColors.resize(pixelCount);
+	m_SamplePrimitiveIds.resize(pixelCount);
+	m_SampleMaterials.resize(pixelCount);
+	m_TracedPixels.assign(pixelCount, 0);
+
+	// Coarse grid of every Nth pixel, last row and column are clamped to the border.
+	// A one pixel wide or high image is a single column or row of blocks with x0 == x1 or y0 == y1
+	const int blocksX{ std::max((m_Width - 1 + m_SubsampleStep - 1) / m_SubsampleStep, 1) };
+	const int blocksY{ std::max((m_Height - 1 + m_SubsampleStep - 1) / m_SubsampleStep, 1) };
+	auto getGridX = [this](int gridX) { return std::min(gridX * m_SubsampleStep, m_Width - 1); };
+	auto getGridY = [this](int gridY) { return std::min(gridY * m_SubsampleStep, m_Height - 1); };
+
+	std::atomic<int> tracedCount{};
+
+	// Grid points first, every block reads the four around it and no block writes them
+	ForEachJob(blocksY + 1, [&](int gridY)
+		{
+			const int py{ getGridY(gridY) };
+			if (gridY > 0 && py == getGridY(gridY - 1))
+			{
+				return;
+			}
+
+			int rowTracedCount{};
+			for (int gridX{}; gridX <= blocksX; ++gridX)
+			{
+				const int px{ getGridX(gridX) };
+				if (gridX > 0 && px == getGridX(gridX - 1))
+				{
+					continue;
+				}
+
+				const int pixelIdx{ px + (py * m_Width) };
+				HitRecord closestHit{};
+				m_SampleColors[pixelIdx] = ShadeViewRay(pScene, m_RayGenerator.GetPixelRay(px, py), closestHit);
+				m_SamplePrimitiveIds[pixelIdx] = closestHit.didHit ? closestHit.primitiveId : -1;
+				m_SampleMaterials[pixelIdx] = closestHit.materialIndex;
+				m_TracedPixels[pixelIdx] = 1;
+				++rowTracedCount;
+			}
+			tracedCount += rowTracedCount;
+		});
+
+	struct BlockSample
+	{
+		ColorRGB color{};
+		int primitiveId{};
+		unsigned char materialIndex{};
+		bool isTraced{};
+	};
+
+	// Every block refines on its own samples. Pixels on an edge with a neighbour may be traced by both,
+	// but a block only writes its right and bottom edge (and the image border), the result doesn't depend on the order
+	ForEachJob(blocksX * blocksY, [&](int blockIdx)
+		{
+			const int x0{ getGridX(blockIdx % blocksX) };
+			const int x1{ getGridX(blockIdx % blocksX + 1) };
+			const int y0{ getGridY(blockIdx / blocksX) };
+			const int y1{ getGridY(blockIdx / blocksX + 1) };
+			const int blockWidth{ x1 - x0 + 1 };
+
+			std::vector<BlockSample> samples(static_cast<size_t>(blockWidth * (y1 - y0 + 1)));
+			auto getSampleIdx = [&](int px, int py) { return (px - x0) + ((py - y0) * blockWidth); };
+
+			// Trace a pixel once, the corners of the block are grid points
+			auto trace = [&](int px, int py)
+			{
+				BlockSample& sample{ samples[getSampleIdx(px, py)] };
+				if (sample.isTraced)
+				{
+					return;
+				}
+
+				if ((px == x0 || px == x1) && (py == y0 || py == y1))
+				{
+					const int pixelIdx{ px + (py * m_Width) };
+					sample = BlockSample{ m_SampleColors[pixelIdx], m_SamplePrimitiveIds[pixelIdx], m_SampleMaterials[pixelIdx], true };
+					return;
+				}
+
+				HitRecord closestHit{};
+				sample.color = ShadeViewRay(pScene, m_RayGenerator.GetPixelRay(px, py), closestHit);
+				sample.primitiveId = closestHit.didHit ? closestHit.primitiveId : -1;
+				sample.materialIndex = closestHit.materialIndex;
+				sample.isTraced = true;
+			};
+
+			auto agrees = [&](int a, int b)
+			{
+				return samples[a].primitiveId == samples[b].primitiveId
+					&& samples[a].materialIndex == samples[b].materialIndex
+					&& std::abs(samples[a].color.GetLuminance() - samples[b].color.GetLuminance()) <= m_SubsampleThreshold;
+			};
+
+			// Corners of the block are always traced, interpolate when they agree, otherwise split in four
+			auto subdivide = [&](auto& self, int sx0, int sy0, int sx1, int sy1) -> void
+			{
+				trace(sx0, sy0);
+				trace(sx1, sy0);
+				trace(sx0, sy1);
+				trace(sx1, sy1);
+
+				if (sx1 - sx0 <= 1 && sy1 - sy0 <= 1)
+				{
+					return;
+				}
+
+				const int topLeft{ getSampleIdx(sx0, sy0) };
+				const int topRight{ getSampleIdx(sx1, sy0) };
+				const int bottomLeft{ getSampleIdx(sx0, sy1) };
+				const int bottomRight{ getSampleIdx(sx1, sy1) };
+
+				const bool cornersAgree{ agrees(topLeft, topRight) && agrees(topLeft, bottomLeft) && agrees(topLeft, bottomRight) };
+				if (!cornersAgree)
+				{
+					const int xm{ (sx0 + sx1) / 2 };
+					const int ym{ (sy0 + sy1) / 2 };
+
+					self(self, sx0, sy0, xm, ym);
+					if (xm != sx1)				self(self, xm, sy0, sx1, ym);
+					if (ym != sy1)				self(self, sx0, ym, xm, sy1);
+					if (xm != sx1 && ym != sy1)	self(self, xm, ym, sx1, sy1);
+					return;
+				}
+
+				// Bilinear interpolation of everything inside that wasn't traced
+				for (int py{ sy0 }; py <= sy1; ++py)
+				{
+					const float ty{ float(py - sy0) / std::max(sy1 - sy0, 1) };
+					const ColorRGB left{ ColorRGB::Lerp(samples[topLeft].color, samples[bottomLeft].color, ty) };
+					const ColorRGB right{ ColorRGB::Lerp(samples[topRight].color, samples[bottomRight].color, ty) };
+
+					for (int px{ sx0 }; px <= sx1; ++px)
+					{
+						BlockSample& sample{ samples[getSampleIdx(px, py)] };
+						if (sample.isTraced)
+						{
+							continue;
+						}
+
+						const float tx{ float(px - sx0) / std::max(sx1 - sx0, 1) };
+						sample.color = ColorRGB::Lerp(left, right, tx);
+					}
+				}
+			};
+
+			subdivide(subdivide, x0, y0, x1, y1);
+
+			// Left and top edge belong to the neighbours, except on the border of the image. Grid points are already written
+			int blockTracedCount{};
+			for (int py{ y0 > 0 ? y0 + 1 : y0 }; py <= y1; ++py)
+			{
+				for (int px{ x0 > 0 ? x0 + 1 : x0 }; px <= x1; ++px)
+				{
+					if ((px == x0 || px == x1) && (py == y0 || py == y1))
+					{
+						continue;
+					}
+
+					const int pixelIdx{ px + (py * m_Width) };
+					const BlockSample& sample{ samples[getSampleIdx(px, py)] };
+					m_SampleColors[pixelIdx] = sample.color;
+					m_SamplePrimitiveIds[pixelIdx] = sample.primitiveId;
+					m_SampleMaterials[pixelIdx] = sample.materialIndex;
+					m_TracedPixels[pixelIdx] = sample.isTraced;
+					blockTracedCount += sample.isTraced;
+				}
+			}
+			tracedCount += blockTracedCount;
+		});
+
+	for (size_t pixelIdx{}; pixelIdx < pixelCount; ++pixelIdx)
+	{
+		ColorRGB finalColor{ m_SampleColors[pixelIdx] };
+
+		// Debug: tint the pixels that were actually traced
+		if (m_SubsampleOverlayEnabled && m_TracedPixels[pixelIdx])
+		{
+			finalColor = ColorRGB::Lerp(finalColor, colors::Red, .5f);
+		}
+
+		m_HDRBuffer[pixelIdx] = finalColor;
+	}
+
+	m_TracedPixelFraction = float(tracedCount) / pixelCount;
+
+	//Tone map and present
+	Present();
+}
+
+void Renderer::CycleSubsampleQuality()
+{
+	MarkSettingsChanged();
+
+	// Smaller starting blocks >> more traced pixels >> less chance to miss small objects
+	switch (m_SubsampleStep)
+	{
+	case 16:
+		m_SubsampleStep = 8;
+		break;
+	case 8:
+		m_SubsampleStep = 4;
+		break;
+	case 4:
+		m_SubsampleStep = 2;
+		break;
+	default:
+		m_SubsampleStep = 16;
+		break;
+	}
+}
+
+void Renderer::RenderDistributed(Scene* pScene)
+{
+	auto& lights = pScene->GetLights();
+
+	const size_t pixelCount{ static_cast<size_t>(m_Width) * m_Height };
+	const size_t lightCount{ lights.size() };
+
+	// Hand out the objects when they're added or replaced, workers only keep their own copy of the scene.
+	// Otherwise only the meshes that moved are copied again
+	const SceneVersions versions{ pScene->GetVersions() };
+	const size_t meshCount{ pScene->GetTriangleMeshGeometries().size() };
+	if (m_Partitions.size() != std::max(m_PartitionCount, size_t{ 1 }) || pScene != m_pPartitionedScene || versions.spheres != m_PartitionedVersions.spheres
+		|| versions.planes != m_PartitionedVersions.planes || meshCount != m_PartitionedMeshCount)
+	{
+		ScenePartition::Build(*pScene, m_PartitionCount, m_Partitions);
+		m_pPartitionedScene = pScene;
+		m_PartitionedVersions = versions;
+		m_PartitionedMeshCount = meshCount;
+	}
+	else
+	{
+		ForEachJob(static_cast<int>(m_Partitions.size()), [&](int partitionIdx)
+			{
+				m_Partitions[partitionIdx].UpdateMeshes(*pScene);
+			});
+	}
+
+	const int partitionCount{ static_cast<int>(m_Partitions.size()) };
+	m_PartitionFragments.resize(m_Partitions.size() * pixelCount);
+
+	// Primary rays, the whole frame as one tile
+	m_RayGenerator.GenerateTile(0, 0, m_Width, m_Height, m_PrimaryRays);
+
+	// Round 1: every worker returns its closest hits, one job per worker and row
+	ForEachJob(partitionCount * m_Height, [&](int jobIdx)
+		{
+			const size_t partitionIdx{ static_cast<size_t>(jobIdx / m_Height) };
+			const size_t firstPixel{ static_cast<size_t>(jobIdx % m_Height) * m_Width };
+			m_Partitions[partitionIdx].TraceClosest(&m_PrimaryRays[firstPixel], m_Width, &m_PartitionFragments[partitionIdx * pixelCount + firstPixel]);
+		});
+
+	// Depth composite and the shadow rays of the visible points, every pixel has a slot per light.
+	// Slots without a shadow ray keep max <= min, the workers skip them
+	const size_t shadowRayCount{ pixelCount * lightCount };
+	m_CompositedFragments.resize(pixelCount);
+	m_ShadowRays.resize(shadowRayCount);
+	ForEachRow([&](int py)
+		{
+			for (size_t pixelIdx{ static_cast<size_t>(py) * m_Width }; pixelIdx < static_cast<size_t>(py + 1) * m_Width; ++pixelIdx)
+			{
+				PartitionFragment& fragment{ m_CompositedFragments[pixelIdx] };
+				fragment = PartitionFragment{};
+				for (size_t partitionIdx{}; partitionIdx < m_Partitions.size(); ++partitionIdx)
+				{
+					const PartitionFragment& partitionFragment{ m_PartitionFragments[partitionIdx * pixelCount + pixelIdx] };
+					if (partitionFragment.depth < fragment.depth)
+					{
+						fragment = partitionFragment;
+					}
+				}
+
+				const Ray& viewRay{ m_PrimaryRays[pixelIdx] };
+				const Vector3 hitPoint{ viewRay.origin + fragment.depth * viewRay.direction };
+
+				for (size_t lightIdx{}; lightIdx < lightCount; ++lightIdx)
+				{
+					Ray& hitToLight{ m_ShadowRays[pixelIdx * lightCount + lightIdx] };
+					hitToLight.max = 0.f;
+					if (fragment.depth == FLT_MAX)
+					{
+						continue;
+					}
+
+					const Vector3 hitToLightDirection{ LightUtils::GetDirectionToLight(lights[lightIdx], hitPoint) };
+					const float hitToLightDirectionMagnitude{ hitToLightDirection.Magnitude() };
 
 					// If !insideBoundaries, continue
 					const bool isInsideBoundaries{ viewRay.min < hitToLightDirectionMagnitude
@@ -97,70 +1107,282 @@ void Renderer::Render(Scene* pScene) const
 					{
 						continue;
 					}
-							
-					// Calculate ObservedArea --> lighted area
-					const float observedArea{ Vector3::Dot(closestHit.normal, hitToLight.direction) };
-					// Check for negative values
+
+					const Vector3 direction{ hitToLightDirection / hitToLightDirectionMagnitude };
+					const float observedArea{ Vector3::Dot(fragment.normal, direction) };
 					if (observedArea < 0)
 					{
 						continue;
 					}
 
-					// If something obstructs, continue
-					if (pScene->DoesHit(hitToLight))
+					hitToLight = Ray{ hitPoint, direction };
+					hitToLight.max = hitToLightDirectionMagnitude;
+				}
+			}
+		});
+
+	// Round 2: every worker checks the shadow rays against its own objects, one job per worker and row.
+	// Then a ray is occluded when any worker says so, folded into the flags of the first worker
+	const size_t rowRayCount{ m_Width * lightCount };
+	if (m_ShadowsEnabled)
+	{
+		m_PartitionOcclusion.resize(m_Partitions.size() * shadowRayCount);
+		ForEachJob(partitionCount * m_Height, [&](int jobIdx)
+			{
+				const size_t partitionIdx{ static_cast<size_t>(jobIdx / m_Height) };
+				const size_t firstRay{ static_cast<size_t>(jobIdx % m_Height) * rowRayCount };
+				m_Partitions[partitionIdx].TraceOcclusion(&m_ShadowRays[firstRay], rowRayCount, &m_PartitionOcclusion[partitionIdx * shadowRayCount + firstRay]);
+			});
+
+		ForEachRow([&](int py)
+			{
+				for (size_t rayIdx{ py * rowRayCount }; rayIdx < (py + 1) * rowRayCount; ++rayIdx)
+				{
+					for (size_t partitionIdx{ 1 }; partitionIdx < m_Partitions.size(); ++partitionIdx)
 					{
-						if (m_ShadowsEnabled) continue;
+						m_PartitionOcclusion[rayIdx] |= m_PartitionOcclusion[partitionIdx * shadowRayCount + rayIdx];
 					}
+				}
+			});
+	}
 
-					// Calculate Radiance --> intensity
-					radiance = LightUtils::GetRadiance(lights[idx], closestHit.origin);
-
-					// Calculate BRDFrgb --> Diffuse + Specular
-					BRDF = materials[closestHit.materialIndex]->Shade(closestHit, hitToLight.direction, viewRay.direction);
-
-					// Calculate finalLightingColor, switch between calculation methods
-					switch (m_CurrentLightMode)
-					{
-					case dae::Renderer::LightingMode::ObservedArea:
-						finalColor += observedArea * ColorRGB{ 1,1,1 };
-						break;
-					case dae::Renderer::LightingMode::Radiance:
-						finalColor += radiance;
-						break;
-					case dae::Renderer::LightingMode::BRDF:
-						finalColor += BRDF;
-						break;
-					case dae::Renderer::LightingMode::Combined:
-						finalColor += radiance * BRDF * observedArea;
-						break;
-							
-					}
-					
+	// Resolve lighting with the kernel of this frame's mode
+	ForEachRow([&](int py)
+		{
+			for (size_t pixelIdx{ static_cast<size_t>(py) * m_Width }; pixelIdx < static_cast<size_t>(py + 1) * m_Width; ++pixelIdx)
+			{
+				const PartitionFragment& fragment{ m_CompositedFragments[pixelIdx] };
+				if (fragment.depth == FLT_MAX)
+				{
+					m_HDRBuffer[pixelIdx] = ColorRGB{};
+					continue;
 				}
 
-				// Update Color in Buffer
-				finalColor.MaxToOne();
-			}		
+				const size_t firstRay{ pixelIdx * lightCount };
+
+				HitRecord closestHit{};
+				closestHit.origin = m_PrimaryRays[pixelIdx].origin + fragment.depth * m_PrimaryRays[pixelIdx].direction;
+				closestHit.normal = fragment.normal;
+				closestHit.t = fragment.depth;
+				closestHit.didHit = true;
+				closestHit.materialIndex = fragment.materialIndex;
+
+				m_HDRBuffer[pixelIdx] = ShadeFragment(pScene, closestHit, m_PrimaryRays[pixelIdx], &m_ShadowRays[firstRay],
+					m_ShadowsEnabled ? &m_PartitionOcclusion[firstRay] : nullptr);
+			}
+		});
+
+	//Tone map and present
+	Present();
+}
+
+void Renderer::Present()
+{
+	ToneMapBuffer();
+
+#ifndef RAYTRACER_HEADLESS
+	//Update SDL Surface
+	if (m_pWindow)
+	{
+		SDL_UpdateWindowSurface(m_pWindow);
+	}
+#endif
+}
+
+void Renderer::PresentRects(const std::vector<PixelRect>& rects)
+{
+	for (const PixelRect& rect : rects)
+	{
+		ToneMapRect(rect.x, rect.y, rect.width, rect.height);
+	}
+
+#ifndef RAYTRACER_HEADLESS
+	//Update SDL Surface, only the given parts
+	if (m_pWindow)
+	{
+		std::vector<SDL_Rect> sdlRects{};
+		sdlRects.reserve(rects.size());
+		for (const PixelRect& rect : rects)
+		{
+			sdlRects.push_back(SDL_Rect{ rect.x, rect.y, rect.width, rect.height });
+		}
+		SDL_UpdateWindowSurfaceRects(m_pWindow, sdlRects.data(), static_cast<int>(sdlRects.size()));
+	}
+#endif
+}
 
-			m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-				static_cast<uint8_t>(finalColor.r * 255),
-				static_cast<uint8_t>(finalColor.g * 255),
-				static_cast<uint8_t>(finalColor.b * 255));
+void Renderer::RenderViews(Scene* pScene, std::vector<Camera>& cameras, std::vector<std::vector<ColorRGB>>& images)
+{
+	SelectKernels();
+
+	// Hit test terms of every view, culling from the frustum of the whole view (a full direction table, one view at a time)
+	const int viewCount{ static_cast<int>(cameras.size()) };
+	m_ViewTerms.resize(cameras.size());
+	if (m_OriginTermsEnabled)
+	{
+		RayGenerator viewRayGenerator{};
+		std::vector<Plane> frustumPlanes{};
+		for (int viewIdx{}; viewIdx < viewCount; ++viewIdx)
+		{
+			viewRayGenerator.Update(cameras[viewIdx], m_FullWidth, m_FullHeight, m_CropX, m_CropY, m_Width, m_Height);
+			pScene->UpdateOriginTerms(viewRayGenerator.GetOrigin(), m_ViewTerms[viewIdx]);
+			if (m_ShadowsEnabled)
+			{
+				viewRayGenerator.GetFrustumPlanes(frustumPlanes);
+				pScene->UpdateLightTerms(viewRayGenerator.GetOrigin(), frustumPlanes, m_ViewTerms[viewIdx]);
+			}
 		}
 	}
 
-	//@END
-	//Update SDL Surface
-	SDL_UpdateWindowSurface(m_pWindow);
+	images.resize(cameras.size());
+	for (std::vector<ColorRGB>& image : images)
+	{
+		image.resize(static_cast<size_t>(m_Width * m_Height));
+	}
+
+	const int tilesX{ (m_Width + m_TileSize - 1) / m_TileSize };
+	const int tilesY{ (m_Height + m_TileSize - 1) / m_TileSize };
+
+	// Job n is tile n / viewCount of view n % viewCount, every view progresses at the same pace
+	ForEachJob(tilesX * tilesY * viewCount, [&](int jobIdx)
+		{
+			const int viewIdx{ jobIdx % viewCount };
+			const int tileIdx{ jobIdx / viewCount };
+			const int x0{ (tileIdx % tilesX) * m_TileSize };
+			const int y0{ (tileIdx / tilesX) * m_TileSize };
+			const int tileWidth{ std::min(m_TileSize, m_Width - x0) };
+			const int tileHeight{ std::min(m_TileSize, m_Height - y0) };
+
+			// Directions of just this tile, a full table per view would cost width * height * 24 bytes each
+			RayGenerator rayGenerator{};
+			rayGenerator.Update(cameras[viewIdx], m_FullWidth, m_FullHeight, m_CropX + x0, m_CropY + y0, tileWidth, tileHeight);
+
+			std::vector<ColorRGB>& image{ images[viewIdx] };
+			for (int py{}; py < tileHeight; ++py)
+			{
+				for (int px{}; px < tileWidth; ++px)
+				{
+					HitRecord closestHit{};
+					image[(x0 + px) + ((y0 + py) * m_Width)] = ShadeViewRay(pScene, m_ViewTerms[viewIdx], rayGenerator.GetPixelRay(px, py), closestHit);
+				}
+			}
+		});
+}
+
+void Renderer::ToneMapToRGB(const std::vector<ColorRGB>& colors, std::vector<uint8_t>& rgb) const
+{
+	std::vector<uint32_t> pixels(colors.size());
+	m_ToneMapper.Apply(colors.data(), pixels.data(), colors.size());
+
+	rgb.resize(colors.size() * 3);
+	for (size_t pixelIdx{}; pixelIdx < colors.size(); ++pixelIdx)
+	{
+		m_ToneMapper.Unpack(pixels[pixelIdx], rgb[pixelIdx * 3], rgb[pixelIdx * 3 + 1], rgb[pixelIdx * 3 + 2]);
+	}
+}
+
+bool Renderer::SetCropWindow(int fullWidth, int fullHeight, int x, int y)
+{
+	if (x < 0 || y < 0 || x + m_Width > fullWidth || y + m_Height > fullHeight)
+	{
+		return false;
+	}
+
+	m_FullWidth = fullWidth;
+	m_FullHeight = fullHeight;
+	m_CropX = x;
+	m_CropY = y;
+
+	// Every pixel sees something else now
+	MarkSettingsChanged();
+	return true;
 }
 
-bool Renderer::SaveBufferToImage() const
+void Renderer::SetThreadCount(int threadCount)
 {
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+	m_ThreadPool.SetThreadCount(threadCount);
+}
+
+void Renderer::ToneMapBuffer()
+{
+	m_ToneMapper.Apply(m_HDRBuffer.data(), m_pBufferPixels, m_HDRBuffer.size());
+	m_LastToneMapVersion = m_ToneMapVersion;
+}
+
+void Renderer::ToneMapRect(int x, int y, int width, int height)
+{
+	for (int py{ y }; py < y + height; ++py)
+	{
+		const int rowStart{ x + (py * m_Width) };
+		m_ToneMapper.Apply(&m_HDRBuffer[rowStart], &m_pBufferPixels[rowStart], static_cast<size_t>(width));
+	}
+}
+
+void Renderer::CycleToneMapOperator()
+{
+	++m_ToneMapVersion;
+
+	switch (m_ToneMapper.GetOperator())
+	{
+	case ToneMapOperator::Clamp:
+		m_ToneMapper.SetOperator(ToneMapOperator::MaxToOne);
+		break;
+	case ToneMapOperator::MaxToOne:
+		m_ToneMapper.SetOperator(ToneMapOperator::Reinhard);
+		break;
+	case ToneMapOperator::Reinhard:
+		m_ToneMapper.SetOperator(ToneMapOperator::ACES);
+		break;
+	case ToneMapOperator::ACES:
+		m_ToneMapper.SetOperator(ToneMapOperator::Clamp);
+		break;
+	}
+}
+
+bool Renderer::SaveBufferToImage(const std::string& path) const
+{
+	return ImageWriter::Encode(CreateImageJob(path, {}));
+}
+
+void Renderer::SaveBufferToImage(ImageWriter& writer, const std::string& path) const
+{
+	writer.Write(CreateImageJob(path, writer.AcquireBuffer()));
+}
+
+void Renderer::StreamBuffer(FrameStream& stream) const
+{
+	stream.Submit(m_pBufferPixels, m_ToneMapper);
+}
+
+ImageJob Renderer::CreateImageJob(const std::string& path, std::vector<uint8_t>&& buffer) const
+{
+	ImageJob job{ path, GetImageFormat(path), m_Width, m_Height, std::move(buffer) };
+
+	if (job.format == ImageFormat::PFM)
+	{
+		job.data.resize(m_HDRBuffer.size() * sizeof(ColorRGB));
+		std::memcpy(job.data.data(), m_HDRBuffer.data(), job.data.size());
+		return job;
+	}
+
+	CopyBufferToRGB(job.data);
+	return job;
+}
+
+void Renderer::CopyBufferToRGB(std::vector<uint8_t>& rgb) const
+{
+	// Tone mapped surface pixels to packed 8 bit RGB
+	rgb.resize(m_HDRBuffer.size() * 3);
+	for (size_t pixelIdx{}; pixelIdx < m_HDRBuffer.size(); ++pixelIdx)
+	{
+		m_ToneMapper.Unpack(m_pBufferPixels[pixelIdx], rgb[pixelIdx * 3], rgb[pixelIdx * 3 + 1], rgb[pixelIdx * 3 + 2]);
+	}
 }
 
 void Renderer::CycleLightingMode()
 {
+	++m_ShadingVersion;
+
 	switch (m_CurrentLightMode)
 	{
 	case dae::Renderer::LightingMode::ObservedArea:
@@ -1,6 +1,16 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
+#include <utility>
+#include <string>
+#include <functional>
+
+#include "ScenePartition.h"
+#include "RayGenerator.h"
+#include "ToneMapper.h"
+#include "ImageWriter.h"
+#include "ThreadPool.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -8,11 +18,18 @@ struct SDL_Surface;
 namespace dae
 {
 	class Scene;
+	class Material;
+	struct Camera;
+	class FrameStream;
 
 	class Renderer final
 	{
 	public:
+#ifndef RAYTRACER_HEADLESS
 		Renderer(SDL_Window* pWindow);
+#endif
+		// Offscreen, no window or SDL needed (headless/batch rendering)
+		Renderer(int width, int height);
 		~Renderer() = default;
 
 		Renderer(const Renderer&) = delete;
@@ -20,11 +37,67 @@ namespace dae
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
-		void Render(Scene* pScene) const;
-		bool SaveBufferToImage() const;
+		// Returns false when nothing changed and the frame was skipped
+		bool Render(Scene* pScene);
+		// Last frame to .png/.ppm (tone mapped) or .pfm (linear), true on success
+		bool SaveBufferToImage(const std::string& path) const;
+		// Same, but only copies the frame, the writer encodes it on its own threads
+		void SaveBufferToImage(ImageWriter& writer, const std::string& path) const;
+		// Tone mapped frame as packed 8 bit RGB
+		void CopyBufferToRGB(std::vector<uint8_t>& rgb) const;
+		// Hands the tone mapped frame to a raw video stream
+		void StreamBuffer(FrameStream& stream) const;
+
+		/**
+		 * \brief The frame of this renderer becomes the width x height window at (x, y) of a larger fullWidth x fullHeight image,
+		 *		  only that window is traced, with the projection of the full image (farm splitting, zoomed previews).
+		 * \return false when the window doesn't fit in the full image
+		 */
+		bool SetCropWindow(int fullWidth, int fullHeight, int x, int y);
+		void ResetCropWindow() { SetCropWindow(m_Width, m_Height, 0, 0); }
+		bool IsCropped() const { return m_FullWidth != m_Width || m_FullHeight != m_Height; }
+
+		/**
+		 * \brief Renders the same scene from every camera, each view gets its own width x height HDR image.
+		 *		  The scene (and the mesh bounds/transforms) is shared and not updated, tiles of all views are interleaved over the threads.
+		 *		  Every view gets its own origin and light terms, the scene's own are left alone.
+		 */
+		void RenderViews(Scene* pScene, std::vector<Camera>& cameras, std::vector<std::vector<ColorRGB>>& images);
+		// Tone mapped 8 bit RGB of any HDR image, current operator and gamma
+		void ToneMapToRGB(const std::vector<ColorRGB>& colors, std::vector<uint8_t>& rgb) const;
+
+		// Rows of a frame are spread over this many threads (calling thread included)
+		void SetThreadCount(int threadCount);
+		int GetThreadCount() const { return m_ThreadPool.GetThreadCount(); }
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
 
 		void CycleLightingMode();
-		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; };
+		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; ++m_ShadingVersion; };
+		void ToggleDistributedRendering() { m_DistributedEnabled = !m_DistributedEnabled; MarkSettingsChanged(); };
+		void ToggleAdaptiveAA() { m_AdaptiveAAEnabled = !m_AdaptiveAAEnabled; MarkSettingsChanged(); };
+		void ToggleSubsampling() { m_SubsamplingEnabled = !m_SubsamplingEnabled; MarkSettingsChanged(); };
+		void ToggleSubsampleOverlay() { m_SubsampleOverlayEnabled = !m_SubsampleOverlayEnabled; MarkSettingsChanged(); };
+		void CycleSubsampleQuality();
+		void ToggleReshade() { m_ReshadeEnabled = !m_ReshadeEnabled; MarkSettingsChanged(); };
+		void ToggleIncremental() { m_IncrementalEnabled = !m_IncrementalEnabled; MarkSettingsChanged(); };
+		void ToggleProgressive() { m_ProgressiveEnabled = !m_ProgressiveEnabled; MarkSettingsChanged(); };
+		void ToggleOriginTerms() { m_OriginTermsEnabled = !m_OriginTermsEnabled; MarkSettingsChanged(); };
+		void CycleToneMapOperator();
+		void ToggleGamma() { m_ToneMapper.SetGamma(m_ToneMapper.GetGamma() == 1.f ? 2.2f : 1.f); ++m_ToneMapVersion; };
+		// Forces the next Render to trace again (e.g. window was exposed)
+		void MarkSettingsChanged() { ++m_SettingsVersion; };
+
+		bool IsAdaptiveAAEnabled() const { return m_AdaptiveAAEnabled; }
+		float GetRefinedPixelFraction() const { return m_RefinedPixelFraction; }
+		bool IsSubsamplingEnabled() const { return m_SubsamplingEnabled; }
+		float GetTracedPixelFraction() const { return m_TracedPixelFraction; }
+		int GetSubsampleStep() const { return m_SubsampleStep; }
+		bool IsIncrementalEnabled() const { return m_IncrementalEnabled; }
+		float GetRetracedTileFraction() const { return m_RetracedTileFraction; }
+		bool IsOriginTermsEnabled() const { return m_OriginTermsEnabled; }
+		// Linear colors of the last frame, before tone mapping
+		const std::vector<ColorRGB>& GetHDRBuffer() const { return m_HDRBuffer; }
 
 	private:
 
@@ -40,11 +113,180 @@ namespace dae
 
 		SDL_Surface* m_pBuffer{};
 		uint32_t* m_pBufferPixels{};
+		std::vector<uint32_t> m_OffscreenPixels{};
 
 		int m_Width{};
 		int m_Height{};
+		ThreadPool m_ThreadPool{}; // Render threads, kept between frames
+
+		// Crop window: the m_Width x m_Height frame starts at (m_CropX, m_CropY) of the full image
+		int m_FullWidth{};
+		int m_FullHeight{};
+		int m_CropX{};
+		int m_CropY{};
+
+		// Everything is traced into the HDR buffer, the tone mapper writes the surface pixels
+		std::vector<ColorRGB> m_HDRBuffer{};
+		ToneMapper m_ToneMapper{};
+		uint32_t m_ToneMapVersion{};
+		uint32_t m_LastToneMapVersion{};
+
+		RayGenerator m_RayGenerator{};
+		bool m_OriginTermsEnabled{ true }; // Primary and shadow rays use per-frame origin terms, shadow rays skip culled objects
+		std::vector<Plane> m_FrustumPlanes{};
+		std::vector<ViewTerms> m_ViewTerms{}; // One per camera of RenderViews
 
 		LightingMode m_CurrentLightMode{ LightingMode::Combined };
 		bool m_ShadowsEnabled{ true };
+
+		// Change tracking of the toggles, combined with the scene state
+		uint32_t m_SettingsVersion{ 1 };	// Toggles that change which rays are traced
+		uint32_t m_ShadingVersion{ 1 };		// Toggles that only change how hits are shaded
+		uint64_t m_LastStateHash{};
+
+		// Adaptive anti-aliasing: first sample of every pixel, extra samples only on edges
+		bool m_AdaptiveAAEnabled{ false };
+		float m_AAThreshold{ 0.1f }; // Max luminance difference between neighbours
+		float m_RefinedPixelFraction{};
+
+		std::vector<ColorRGB> m_SampleColors{};
+		std::vector<int> m_SamplePrimitiveIds{};
+		std::vector<unsigned char> m_SampleMaterials{};
+		std::vector<uint8_t> m_RefinePixels{};
+
+		// Closest hit + shadow rays + shading, optionally returns the occlusion bit of every light
+		ColorRGB ShadeViewRay(Scene* pScene, const Ray& viewRay, HitRecord& closestHit, uint32_t* pShadowMask = nullptr) const;
+		// Same, for a camera other than the scene's own
+		ColorRGB ShadeViewRay(Scene* pScene, const ViewTerms& viewTerms, const Ray& viewRay, HitRecord& closestHit) const
+		{
+			return (this->*m_pShadeViewRayKernel)(pScene, viewTerms, viewRay, closestHit, nullptr);
+		}
+		// Shading of an already known hit, occlusion from the shadow mask
+		ColorRGB ShadeHit(Scene* pScene, const HitRecord& closestHit, const Ray& viewRay, uint32_t shadowMask) const
+		{
+			return (this->*m_pShadeHitKernel)(pScene, closestHit, viewRay, shadowMask);
+		}
+		// Shading of a composited fragment, with its shadow ray and occlusion flag per light (pOcclusion unused without shadows)
+		ColorRGB ShadeFragment(Scene* pScene, const HitRecord& closestHit, const Ray& viewRay, const Ray* pShadowRays, const uint8_t* pOcclusion) const
+		{
+			return (this->*m_pShadeFragmentKernel)(pScene, closestHit, viewRay, pShadowRays, pOcclusion);
+		}
+
+		// Kernels specialized for every (LightingMode, shadows) combination, selected once per frame
+		using ShadeViewRayKernelFn = ColorRGB(Renderer::*)(Scene*, const ViewTerms&, const Ray&, HitRecord&, uint32_t*) const;
+		using ShadeHitKernelFn = ColorRGB(Renderer::*)(Scene*, const HitRecord&, const Ray&, uint32_t) const;
+		using ShadeFragmentKernelFn = ColorRGB(Renderer::*)(Scene*, const HitRecord&, const Ray&, const Ray*, const uint8_t*) const;
+
+		ShadeViewRayKernelFn m_pShadeViewRayKernel{};
+		ShadeHitKernelFn m_pShadeHitKernel{};
+		ShadeFragmentKernelFn m_pShadeFragmentKernel{};
+
+		void SelectKernels();
+		template<LightingMode Mode>
+		void SelectKernels();
+
+		template<LightingMode Mode, bool ShadowsEnabled>
+		ColorRGB ShadeViewRayKernel(Scene* pScene, const ViewTerms& viewTerms, const Ray& viewRay, HitRecord& closestHit, uint32_t* pShadowMask) const;
+		template<LightingMode Mode, bool ShadowsEnabled>
+		ColorRGB ShadeHitKernel(Scene* pScene, const HitRecord& closestHit, const Ray& viewRay, uint32_t shadowMask) const;
+		template<LightingMode Mode, bool ShadowsEnabled>
+		ColorRGB ShadeFragmentKernel(Scene* pScene, const HitRecord& closestHit, const Ray& viewRay, const Ray* pShadowRays, const uint8_t* pOcclusion) const;
+		template<LightingMode Mode, bool ShadowsEnabled, bool TraceShadows>
+		ColorRGB ShadeLightsKernel(Scene* pScene, const ViewTerms& viewTerms, const HitRecord& closestHit, const Ray& viewRay, uint32_t& shadowMask) const;
+		// Contribution of one unoccluded light, only what the mode needs
+		template<LightingMode Mode>
+		static ColorRGB ShadeLightKernel(const Light& light, Material* pMaterial, const HitRecord& closestHit, const Vector3& lightDirection,
+			const Vector3& viewDirection, float observedArea);
+		void RefineEdges(Scene* pScene);
+
+		// Progressive accumulation: while nothing changes every frame adds a jittered sample per pixel
+		bool m_ProgressiveEnabled{ true };
+		uint32_t m_AccumulatedFrames{};
+		uint32_t m_MaxAccumulatedFrames{ 64 };
+
+		std::vector<ColorRGB> m_AccumulationBuffer{};
+
+		void RenderProgressive(Scene* pScene);
+
+		// G-buffer of the primary hits (position, normal, material, view ray) + per-light shadow mask
+		bool m_ReshadeEnabled{ true };
+		bool m_HasGBuffer{ false };
+		bool m_GBufferHasShadowMasks{ false }; // Only with shadows and at most m_MaxShadowMaskLights lights
+		uint32_t m_LastShadingVersion{};
+
+		std::vector<HitRecord> m_GBufferHits{};
+		std::vector<Ray> m_GBufferViewRays{};
+		std::vector<uint32_t> m_GBufferShadowMasks{};
+		static constexpr size_t m_MaxShadowMaskLights{ 32 }; // Bits of a shadow mask
+
+		bool RenderReshade(Scene* pScene, bool canAccumulate);
+		void StoreGBufferState(Scene* pScene);
+
+		// Incremental rendering: when only meshes moved, retrace the tiles touched by their old/new bounds and shadows
+		struct MeshBounds
+		{
+			uint32_t version{};
+			Vector3 minAABB{};
+			Vector3 maxAABB{};
+		};
+
+		bool m_IncrementalEnabled{ true };
+		int m_TileSize{ 32 };
+		float m_RetracedTileFraction{ 1.f };
+
+		SceneVersions m_LastVersions{};
+		uint32_t m_LastSettingsVersion{};
+		std::vector<MeshBounds> m_LastMeshBounds{};
+		std::vector<std::pair<Vector3, Vector3>> m_ChangedBounds{};
+		std::vector<uint8_t> m_DirtyTiles{};
+		std::vector<int> m_DirtyTileIndices{};
+
+		bool RenderIncremental(Scene* pScene, bool canAccumulate);
+
+		// Coarse-to-fine subsampling: trace every Nth pixel, split blocks whose corners disagree
+		bool m_SubsamplingEnabled{ false };
+		bool m_SubsampleOverlayEnabled{ false };
+		int m_SubsampleStep{ 8 }; // Quality knob, size of the starting blocks
+		float m_SubsampleThreshold{ 0.05f };
+		float m_TracedPixelFraction{};
+
+		std::vector<uint8_t> m_TracedPixels{};
+
+		void RenderSubsampled(Scene* pScene);
+
+		// Sort-last rendering: every worker only holds a part of the scene
+		bool m_DistributedEnabled{ false };
+		size_t m_PartitionCount{ 4 };
+
+		// Partitions are built again when these change, moved meshes are copied into them every frame
+		std::vector<ScenePartition> m_Partitions{};
+		const Scene* m_pPartitionedScene{};
+		SceneVersions m_PartitionedVersions{};
+		size_t m_PartitionedMeshCount{};
+
+		std::vector<Ray> m_PrimaryRays{};
+		std::vector<Ray> m_ShadowRays{}; // A slot per pixel and light, max <= min when nothing is traced
+		std::vector<PartitionFragment> m_PartitionFragments{}; // Per partition, the fragments of every pixel
+		std::vector<uint8_t> m_PartitionOcclusion{}; // Per partition, a flag per shadow ray slot
+		std::vector<PartitionFragment> m_CompositedFragments{};
+
+		void RenderDistributed(Scene* pScene);
+
+		// Part of the frame, in pixels
+		struct PixelRect
+		{
+			int x{};
+			int y{};
+			int width{};
+			int height{};
+		};
+
+		void Present();
+		void PresentRects(const std::vector<PixelRect>& rects);
+		void ForEachRow(const std::function<void(int)>& rowJob) { ForEachJob(m_Height, rowJob); }
+		void ForEachJob(int jobCount, const std::function<void(int)>& job) { m_ThreadPool.ForEachJob(jobCount, job); }
+		void ToneMapBuffer();
+		ImageJob CreateImageJob(const std::string& path, std::vector<uint8_t>&& buffer) const;
+		void ToneMapRect(int x, int y, int width, int height);
 	};
 }
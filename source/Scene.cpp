@@ -1,6 +1,14 @@
+#include <chrono>
+#include <climits>
+#include <iostream>
+
 #include "Scene.h"
 #include "Utils.h"
 #include "Material.h"
+#include "MeshLoader.h"
+#include "MeshBVH.h"
+#include "MeshOptimizer.h"
+#include "GltfLoader.h"
 
 namespace dae {
 
@@ -39,6 +47,7 @@ namespace dae {
 			if (tempHitRecord.t < closestHit.t && tempHitRecord.t >= 0)
 			{
 				closestHit = tempHitRecord;
+				closestHit.primitiveId = static_cast<int>(idx);
 			}
 		}
 
@@ -49,6 +58,7 @@ namespace dae {
 			if (tempHitRecord.t < closestHit.t && tempHitRecord.t >= 0)
 			{
 				closestHit = tempHitRecord;
+				closestHit.primitiveId = static_cast<int>(m_SphereGeometries.size() + idx);
 			}
 		}
 
@@ -59,6 +69,67 @@ namespace dae {
 			if (tempHitRecord.t < closestHit.t && tempHitRecord.t >= 0)
 			{
 				closestHit = tempHitRecord;
+				closestHit.primitiveId = static_cast<int>(m_SphereGeometries.size() + m_PlaneGeometries.size() + idx);
+			}
+		}
+	}
+
+	void Scene::UpdateOriginTerms(const Vector3& origin, ViewTerms& viewTerms) const
+	{
+		viewTerms.origin = origin;
+
+		viewTerms.sphereTerms.resize(m_SphereGeometries.size());
+		for (size_t idx{}; idx < m_SphereGeometries.size(); idx++)
+		{
+			viewTerms.sphereTerms[idx] = GeometryUtils::GetOriginTerms(m_SphereGeometries[idx], origin);
+		}
+
+		viewTerms.planeTerms.resize(m_PlaneGeometries.size());
+		for (size_t idx{}; idx < m_PlaneGeometries.size(); idx++)
+		{
+			viewTerms.planeTerms[idx] = GeometryUtils::GetOriginTerms(m_PlaneGeometries[idx], origin);
+		}
+	}
+
+	void Scene::GetClosestHitFromOrigin(const Ray& ray, HitRecord& closestHit, const ViewTerms& viewTerms) const
+	{
+		assert(viewTerms.sphereTerms.size() == m_SphereGeometries.size() && viewTerms.planeTerms.size() == m_PlaneGeometries.size()
+			&& "Origin terms are out of date, call UpdateOriginTerms after changing the geometry");
+		assert(ray.origin.x == viewTerms.origin.x && ray.origin.y == viewTerms.origin.y && ray.origin.z == viewTerms.origin.z
+			&& "Ray doesn't start at the origin of the terms");
+
+		HitRecord tempHitRecord{};
+
+		// Spheres
+		for (size_t idx{}; idx < m_SphereGeometries.size(); idx++)
+		{
+			GeometryUtils::HitTest_Sphere(m_SphereGeometries[idx], viewTerms.sphereTerms[idx], ray, tempHitRecord);
+			if (tempHitRecord.t < closestHit.t && tempHitRecord.t >= 0)
+			{
+				closestHit = tempHitRecord;
+				closestHit.primitiveId = static_cast<int>(idx);
+			}
+		}
+
+		// Planes
+		for (size_t idx{}; idx < m_PlaneGeometries.size(); idx++)
+		{
+			GeometryUtils::HitTest_Plane(m_PlaneGeometries[idx], viewTerms.planeTerms[idx], ray, tempHitRecord);
+			if (tempHitRecord.t < closestHit.t && tempHitRecord.t >= 0)
+			{
+				closestHit = tempHitRecord;
+				closestHit.primitiveId = static_cast<int>(m_SphereGeometries.size() + idx);
+			}
+		}
+
+		// Triangles, nothing to hoist
+		for (size_t idx{}; idx < m_TriangleMeshGeometries.size(); idx++)
+		{
+			GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[idx], ray, tempHitRecord);
+			if (tempHitRecord.t < closestHit.t && tempHitRecord.t >= 0)
+			{
+				closestHit = tempHitRecord;
+				closestHit.primitiveId = static_cast<int>(m_SphereGeometries.size() + m_PlaneGeometries.size() + idx);
 			}
 		}
 	}
@@ -104,6 +175,242 @@ namespace dae {
 		return false;
 	}
 
+
+	void Scene::UpdateLightTerms(const Vector3& cameraOrigin, const std::vector<Plane>& frustumPlanes, ViewTerms& viewTerms) const
+	{
+		std::vector<Plane>& visibleBounds{ viewTerms.visibleBounds };
+
+		// Half-spaces holding every visible point: the frustum, and the camera side of every plane
+		// (a primary ray can't reach the other side without hitting the plane first)
+		visibleBounds = frustumPlanes;
+		for (const Plane& plane : m_PlaneGeometries)
+		{
+			const float cameraSide{ Vector3::Dot(cameraOrigin - plane.origin, plane.normal) };
+			if (cameraSide != 0)
+			{
+				visibleBounds.push_back(Plane{ plane.origin, cameraSide > 0 ? plane.normal : -plane.normal });
+			}
+		}
+
+		viewTerms.lightTerms.resize(m_Lights.size());
+		for (size_t lightIdx{}; lightIdx < m_Lights.size(); lightIdx++)
+		{
+			const Light& light{ m_Lights[lightIdx] };
+			LightTerms& lightTerms{ viewTerms.lightTerms[lightIdx] };
+			lightTerms.isAnchored = light.type == LightType::Point;
+
+			// Signed distance of the light to a bound, directional lights are infinitely far along -direction
+			auto getLightSide = [&light](const Plane& bound)
+			{
+				if (light.type == LightType::Directional)
+				{
+					return Vector3::Dot(-light.direction, bound.normal);
+				}
+				return Vector3::Dot(light.origin - bound.origin, bound.normal);
+			};
+
+			// Bounds with the light inside also hold every shadow ray
+			auto isOutsideShadowRays = [&](auto isOutside)
+			{
+				for (const Plane& bound : visibleBounds)
+				{
+					if (getLightSide(bound) >= 0 && isOutside(bound))
+					{
+						return true;
+					}
+				}
+				return false;
+			};
+
+			// Spheres
+			lightTerms.sphereIndices.clear();
+			lightTerms.sphereTerms.clear();
+			for (size_t idx{}; idx < m_SphereGeometries.size(); idx++)
+			{
+				const Sphere& sphere{ m_SphereGeometries[idx] };
+				if (isOutsideShadowRays([&sphere](const Plane& bound) { return Vector3::Dot(sphere.origin - bound.origin, bound.normal) < -sphere.radius; }))
+				{
+					continue;
+				}
+
+				lightTerms.sphereIndices.push_back(static_cast<uint32_t>(idx));
+				if (lightTerms.isAnchored)
+				{
+					lightTerms.sphereTerms.push_back(GeometryUtils::GetOriginTerms(sphere, light.origin));
+				}
+			}
+
+			// Planes, can only block when the light and the camera are on different sides
+			lightTerms.planeIndices.clear();
+			lightTerms.planeTerms.clear();
+			for (size_t idx{}; idx < m_PlaneGeometries.size(); idx++)
+			{
+				const Plane& plane{ m_PlaneGeometries[idx] };
+				const float cameraSide{ Vector3::Dot(cameraOrigin - plane.origin, plane.normal) };
+				const float lightSide{ getLightSide(plane) };
+				if (cameraSide * lightSide > 0)
+				{
+					continue;
+				}
+
+				lightTerms.planeIndices.push_back(static_cast<uint32_t>(idx));
+				if (lightTerms.isAnchored)
+				{
+					lightTerms.planeTerms.push_back(GeometryUtils::GetOriginTerms(plane, light.origin));
+				}
+			}
+
+			// Triangle meshes, on their bounding box
+			lightTerms.triangleMeshIndices.clear();
+			for (size_t idx{}; idx < m_TriangleMeshGeometries.size(); idx++)
+			{
+				const TriangleMesh& mesh{ m_TriangleMeshGeometries[idx] };
+				auto isOutside = [&mesh](const Plane& bound)
+				{
+					// Corner furthest along the normal
+					const Vector3 corner{ bound.normal.x > 0 ? mesh.transformedMaxAABB.x : mesh.transformedMinAABB.x,
+										  bound.normal.y > 0 ? mesh.transformedMaxAABB.y : mesh.transformedMinAABB.y,
+										  bound.normal.z > 0 ? mesh.transformedMaxAABB.z : mesh.transformedMinAABB.z };
+					return Vector3::Dot(corner - bound.origin, bound.normal) < 0;
+				};
+
+				if (!isOutsideShadowRays(isOutside))
+				{
+					lightTerms.triangleMeshIndices.push_back(static_cast<uint32_t>(idx));
+				}
+			}
+		}
+	}
+
+	bool Scene::DoesHitLight(size_t lightIndex, const Ray& hitToLight, const ViewTerms& viewTerms) const
+	{
+		assert(lightIndex < viewTerms.lightTerms.size() && "Light terms are out of date, call UpdateLightTerms after changing the lights");
+		const LightTerms& lightTerms{ viewTerms.lightTerms[lightIndex] };
+
+		HitRecord tempHitRecord{};
+
+		// Same offset as DoesHit
+		Ray adjustedRay{ hitToLight };
+		adjustedRay.origin = hitToLight.origin + 0.0001f * hitToLight.direction;
+
+		if (lightTerms.isAnchored)
+		{
+			// Same segment, walked from the light towards the hit point. Near its end (the surface the hit point lies on,
+			// at grazing angles) the two directions round differently: hits that close are decided by DoesHit's own test
+			const float segmentLength{ hitToLight.max - 0.0001f - hitToLight.min };
+			const float endEpsilon{ 0.01f * std::max(hitToLight.max, 1.f) };
+
+			Ray lightToHit{};
+			lightToHit.origin = m_Lights[lightIndex].origin;
+			lightToHit.direction = -hitToLight.direction;
+			lightToHit.max = segmentLength + endEpsilon;
+
+			// Spheres
+			for (size_t idx{}; idx < lightTerms.sphereIndices.size(); idx++)
+			{
+				const Sphere& sphere{ m_SphereGeometries[lightTerms.sphereIndices[idx]] };
+				if (GeometryUtils::HitTest_Sphere(sphere, lightTerms.sphereTerms[idx], lightToHit, tempHitRecord)
+					&& (tempHitRecord.t < segmentLength - endEpsilon || GeometryUtils::HitTest_Sphere(sphere, adjustedRay, tempHitRecord, true)))
+				{
+					return true;
+				}
+			}
+
+			// Planes
+			for (size_t idx{}; idx < lightTerms.planeIndices.size(); idx++)
+			{
+				const Plane& plane{ m_PlaneGeometries[lightTerms.planeIndices[idx]] };
+				if (GeometryUtils::HitTest_Plane(plane, lightTerms.planeTerms[idx], lightToHit, tempHitRecord)
+					&& (tempHitRecord.t < segmentLength - endEpsilon || GeometryUtils::HitTest_Plane(plane, adjustedRay, tempHitRecord, true)))
+				{
+					return true;
+				}
+			}
+		}
+		else
+		{
+			// Spheres
+			for (const uint32_t sphereIdx : lightTerms.sphereIndices)
+			{
+				if (GeometryUtils::HitTest_Sphere(m_SphereGeometries[sphereIdx], adjustedRay, tempHitRecord, true))
+				{
+					return true;
+				}
+			}
+
+			// Planes
+			for (const uint32_t planeIdx : lightTerms.planeIndices)
+			{
+				if (GeometryUtils::HitTest_Plane(m_PlaneGeometries[planeIdx], adjustedRay, tempHitRecord, true))
+				{
+					return true;
+				}
+			}
+		}
+
+		// Triangles, culling depends on the direction so they're always traced from the hit point
+		for (const uint32_t meshIdx : lightTerms.triangleMeshIndices)
+		{
+			if (GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[meshIdx], adjustedRay, tempHitRecord, true))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	SceneVersions Scene::GetVersions() const
+	{
+		SceneVersions versions{};
+		versions.camera = m_Camera.version;
+		versions.spheres = m_SphereVersion;
+		versions.planes = m_PlaneVersion;
+		versions.triangleMeshes = m_TriangleMeshVersion;
+		versions.lights = m_LightVersion;
+		versions.lightColors = m_LightColorVersion;
+		versions.materials = m_MaterialVersion;
+
+		return versions;
+	}
+
+	uint64_t Scene::GetStateHash() const
+	{
+		const SceneVersions versions{ GetVersions() };
+
+		uint64_t hash{};
+		hash = HashCombine(hash, versions.camera);
+		hash = HashCombine(hash, versions.spheres);
+		hash = HashCombine(hash, versions.planes);
+		hash = HashCombine(hash, versions.triangleMeshes);
+		hash = HashCombine(hash, versions.lights);
+		hash = HashCombine(hash, versions.lightColors);
+		hash = HashCombine(hash, versions.materials);
+
+		return hash;
+	}
+
+	void Scene::SetLightColor(size_t lightIndex, const ColorRGB& color)
+	{
+		m_Lights[lightIndex].color = color;
+		++m_LightColorVersion;
+	}
+
+	void Scene::SetLightIntensity(size_t lightIndex, float intensity)
+	{
+		m_Lights[lightIndex].intensity = intensity;
+		++m_LightColorVersion;
+	}
+
+	void Scene::ScaleLightIntensities(float factor)
+	{
+		for (Light& light : m_Lights)
+		{
+			light.intensity *= factor;
+		}
+		++m_LightColorVersion;
+	}
+
 #pragma region Scene Helpers
 	Sphere* Scene::AddSphere(const Vector3& origin, float radius, unsigned char materialIndex)
 	{
@@ -113,6 +420,7 @@ namespace dae {
 		s.materialIndex = materialIndex;
 
 		m_SphereGeometries.emplace_back(s);
+		++m_SphereVersion;
 		return &m_SphereGeometries.back();
 	}
 
@@ -124,6 +432,7 @@ namespace dae {
 		p.materialIndex = materialIndex;
 
 		m_PlaneGeometries.emplace_back(p);
+		++m_PlaneVersion;
 		return &m_PlaneGeometries.back();
 	}
 
@@ -132,11 +441,93 @@ namespace dae {
 		TriangleMesh m{};
 		m.cullMode = cullMode;
 		m.materialIndex = materialIndex;
+		m.useCompactVertices = m_UseCompactVertices;
 
 		m_TriangleMeshGeometries.emplace_back(m);
+		++m_TriangleMeshVersion;
 		return &m_TriangleMeshGeometries.back();
 	}
 
+	bool Scene::LoadTriangleMesh(TriangleMesh* pMesh, const std::string& path)
+	{
+		MeshLoadStats stats{};
+		if (!MeshLoader::LoadTriangleMesh(path, *pMesh, m_UseMeshCache, m_OptimizeMeshes, &stats))
+		{
+			std::clog << "Failed to load mesh " << path << "\n";
+			return false;
+		}
+
+		// stderr, stdout may carry a frame stream
+		std::clog << "Loaded " << path << (stats.isFromCache ? " (cache)" : "") << ": " << stats.triangleCount << " triangles, "
+			<< stats.vertexCount << " vertices" << (pMesh->compactIndices.empty() ? ", " : " (16 bit indices), ")
+			<< stats.byteCount / 1024 << " KB in " << stats.seconds * 1000.0 << " ms (" << stats.GetMegabytesPerSecond() << " MB/s)\n";
+		++m_TriangleMeshVersion;
+		return true;
+	}
+
+	bool Scene::LoadGltfScene(const std::string& path)
+	{
+		const auto startTime{ std::chrono::steady_clock::now() };
+
+		GltfData data{};
+		MeshLoadStats stats{};
+		if (!GltfLoader::ParseGLB(path, data, &stats))
+		{
+			std::clog << "Failed to load glTF scene " << path << "\n";
+			return false;
+		}
+
+		// Material indices are a byte, files with more materials than that fall back to the glTF default material
+		const auto addMaterial = [this](const GltfMaterial& material)
+		{
+			return AddMaterial(new Material_CookTorrence(material.baseColor, material.metallic, material.roughness));
+		};
+		const unsigned char defaultMaterialIdx{ addMaterial(GltfMaterial{}) };
+		std::vector<unsigned char> materialIndices{};
+		for (const GltfMaterial& material : data.materials)
+		{
+			materialIndices.push_back(m_Materials.size() < UCHAR_MAX ? addMaterial(material) : defaultMaterialIdx);
+		}
+
+		// A primitive is optimized, gets its BVH and is shared once, every instance only keeps a transform to it
+		std::vector<std::shared_ptr<const TriangleMesh>> sharedMeshes(data.primitives.size());
+		for (const GltfInstance& instance : data.instances)
+		{
+			GltfPrimitive& primitive{ data.primitives[instance.primitiveIdx] };
+			const bool hasMaterial{ primitive.materialIdx >= 0 };
+			const bool isDoubleSided{ hasMaterial && data.materials[primitive.materialIdx].isDoubleSided };
+			const TriangleCullMode cullMode{ isDoubleSided ? TriangleCullMode::NoCulling : TriangleCullMode::BackFaceCulling };
+			const unsigned char materialIdx{ hasMaterial ? materialIndices[primitive.materialIdx] : defaultMaterialIdx };
+
+			std::shared_ptr<const TriangleMesh>& pSharedMesh{ sharedMeshes[instance.primitiveIdx] };
+			if (!pSharedMesh)
+			{
+				TriangleMesh& mesh{ primitive.mesh };
+				MeshLoader::CalculateFaceNormals(mesh.positions, mesh.indices, mesh.normals);
+				if (m_OptimizeMeshes)
+					MeshOptimizer::Optimize(mesh);
+				MeshBVH::Build(mesh);
+
+				mesh.cullMode = cullMode;
+				mesh.materialIndex = materialIdx;
+				mesh.useCompactVertices = m_UseCompactVertices;
+				mesh.UpdateTransforms();
+				pSharedMesh = std::make_shared<const TriangleMesh>(std::move(mesh));
+			}
+
+			TriangleMesh* pMesh{ AddTriangleMesh(cullMode, materialIdx) };
+			pMesh->pInstancedMesh = pSharedMesh;
+			pMesh->instanceTransform = instance.worldTransform;
+			pMesh->UpdateTransforms();
+		}
+
+		const double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() };
+		std::clog << "Loaded " << path << ": " << data.primitives.size() << " primitives, " << data.instances.size() << " instances, "
+			<< stats.triangleCount << " triangles, " << stats.byteCount / 1024 << " KB, parsed in " << stats.seconds * 1000.0
+			<< " ms (" << stats.GetMegabytesPerSecond() << " MB/s), " << seconds * 1000.0 << " ms with BVHs\n";
+		return true;
+	}
+
 	Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
 	{
 		Light l;
@@ -146,6 +537,7 @@ namespace dae {
 		l.type = LightType::Point;
 
 		m_Lights.emplace_back(l);
+		++m_LightVersion;
 		return &m_Lights.back();
 	}
 
@@ -158,12 +550,14 @@ namespace dae {
 		l.type = LightType::Directional;
 
 		m_Lights.emplace_back(l);
+		++m_LightVersion;
 		return &m_Lights.back();
 	}
 
 	unsigned char Scene::AddMaterial(Material* pMaterial)
 	{
 		m_Materials.push_back(pMaterial);
+		++m_MaterialVersion;
 		return static_cast<unsigned char>(m_Materials.size() - 1);
 	}
 #pragma endregion
@@ -359,12 +753,9 @@ namespace dae {
 		//pMesh->UpdateTransforms();
 
 		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/simple_object.obj",
-						pMesh->positions,
-						pMesh->normals,
-						pMesh->indices);
+		LoadTriangleMesh(pMesh, "Resources/simple_object.obj");
 
-		// No need to CalculateNormals, these are done inside ParseOBJ function
+		// No need to CalculateNormals, LoadTriangleMesh already fills the face normals
 		pMesh->Scale({ .7f,.7f,.7f });
 		pMesh->Translate({ .0f,1.f,.0f });
 
@@ -382,6 +773,8 @@ namespace dae {
 
 		pMesh->RotateY(PI_DIV_2 * pTimer->GetTotal());
 		pMesh->UpdateTransforms();
+
+		++m_TriangleMeshVersion;
 	}
 #pragma endregion
 
@@ -451,6 +844,8 @@ namespace dae {
 			m->RotateY(yawAngle);
 			m->UpdateTransforms();
 		}
+
+		++m_TriangleMeshVersion;
 	}
 #pragma endregion
 
@@ -472,12 +867,9 @@ namespace dae {
 		AddPlane(Vector3{ -5.f,0.f,0.f }, Vector3{ 1.f,0.f,0.f }, matLambert_GrayBlue);		// Left
 
 		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/lowpoly_bunny.obj",
-			pMesh->positions,
-			pMesh->normals,
-			pMesh->indices);
+		LoadTriangleMesh(pMesh, "Resources/lowpoly_bunny.obj");
 
-		// No need to CalculateNormals, these are done inside ParseOBJ function
+		// No need to CalculateNormals, LoadTriangleMesh already fills the face normals
 		pMesh->Scale({ 2.f,2.f,2.f });
 
 		pMesh->UpdateTransforms();
@@ -494,6 +886,72 @@ namespace dae {
 
 		pMesh->RotateY(PI_DIV_2 * pTimer->GetTotal());
 		pMesh->UpdateTransforms();
+
+		++m_TriangleMeshVersion;
+	}
+#pragma endregion
+
+#pragma region GLTF SCENE
+	GltfScene::GltfScene(const std::string& path) :
+		m_Path(path)
+	{
+	}
+
+	void GltfScene::Initialize()
+	{
+		m_Camera.fovAngle = 45.f;
+
+		LoadGltfScene(m_Path);
+		if (m_TriangleMeshGeometries.empty())
+		{
+			return;
+		}
+
+		Vector3 minAABB{ m_TriangleMeshGeometries[0].transformedMinAABB };
+		Vector3 maxAABB{ m_TriangleMeshGeometries[0].transformedMaxAABB };
+		for (const TriangleMesh& mesh : m_TriangleMeshGeometries)
+		{
+			minAABB = Vector3::Min(minAABB, mesh.transformedMinAABB);
+			maxAABB = Vector3::Max(maxAABB, mesh.transformedMaxAABB);
+		}
+
+		// Looking along +z at the bounding sphere, which just fits the vertical field of view
+		const Vector3 center{ (minAABB + maxAABB) * .5f };
+		const float radius{ std::max((maxAABB - minAABB).Magnitude() * .5f, .001f) };
+		m_Camera.origin = center - Vector3::UnitZ * (radius / std::sin(m_Camera.fovAngle * .5f * TO_RADIANS));
+
+		// Lights of BunnyScene_W4, scaled to the size of the asset
+		const float scale{ radius / 2.f };
+		AddPointLight(center + Vector3{ 0.f,5.f,5.f } * scale, 50.f * scale * scale, ColorRGB{ 1.f,.61f,.45f });		// BackLight
+		AddPointLight(center + Vector3{ -2.5f,5.f,-5.f } * scale, 70.f * scale * scale, ColorRGB{ 1.f,.8f,.45f });	// Front Left Light
+		AddPointLight(center + Vector3{ 2.5f,2.5f,-5.f } * scale, 50.f * scale * scale, ColorRGB{ .34f,.47f,.68f });
+	}
+#pragma endregion
+
+#pragma region SCENE FACTORY
+	Scene* CreateScene(const std::string& sceneName)
+	{
+		if (sceneName.size() > 4 && sceneName.compare(sceneName.size() - 4, 4, ".glb") == 0)
+			return new GltfScene(sceneName);
+
+		if (sceneName == "Scene_W1")			return new Scene_W1();
+		if (sceneName == "Scene_W2")			return new Scene_W2();
+		if (sceneName == "Scene_W3_TestScene")	return new Scene_W3_TestScene();
+		if (sceneName == "Scene_W3")			return new Scene_W3();
+		if (sceneName == "TestScene_W4")		return new TestScene_W4();
+		if (sceneName == "ReferenceScene_W4")	return new ReferenceScene_W4();
+		if (sceneName == "BunnyScene_W4")		return new BunnyScene_W4();
+
+		return nullptr;
+	}
+
+	const std::vector<std::string>& GetSceneNames()
+	{
+		static const std::vector<std::string> sceneNames
+		{
+			"Scene_W1", "Scene_W2", "Scene_W3_TestScene", "Scene_W3", "TestScene_W4", "ReferenceScene_W4", "BunnyScene_W4"
+		};
+		return sceneNames;
 	}
 #pragma endregion
 
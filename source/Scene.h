@@ -33,14 +33,50 @@ namespace dae
 			m_Camera.Update(pTimer);
 		}
 
+		// Hash of all versions, stays the same as long as nothing visible changed
+		uint64_t GetStateHash() const;
+		SceneVersions GetVersions() const;
+
 		Camera& GetCamera() { return m_Camera; }
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
+		// Primary rays all leave the camera, calculate the terms that only depend on their origin once per frame
+		void UpdateOriginTerms(const Vector3& origin) { UpdateOriginTerms(origin, m_ViewTerms); }
+		void UpdateOriginTerms(const Vector3& origin, ViewTerms& viewTerms) const;
+		// Same as GetClosestHit, for rays starting at the origin passed to UpdateOriginTerms
+		void GetClosestHitFromOrigin(const Ray& ray, HitRecord& closestHit) const { GetClosestHitFromOrigin(ray, closestHit, m_ViewTerms); }
+		void GetClosestHitFromOrigin(const Ray& ray, HitRecord& closestHit, const ViewTerms& viewTerms) const;
 		bool DoesHit(const Ray& ray) const;
+		/**
+		 * \brief Per-frame shadow ray setup, call after the lights and geometry are updated.
+		 *		  Point lights get their sphere and plane terms calculated from the light origin,
+		 *		  objects that can't be between a light and any point visible from the camera are skipped.
+		 * \param cameraOrigin origin of all primary rays
+		 * \param frustumPlanes side planes of the view frustum, normals pointing inside
+		 */
+		void UpdateLightTerms(const Vector3& cameraOrigin, const std::vector<Plane>& frustumPlanes) { UpdateLightTerms(cameraOrigin, frustumPlanes, m_ViewTerms); }
+		void UpdateLightTerms(const Vector3& cameraOrigin, const std::vector<Plane>& frustumPlanes, ViewTerms& viewTerms) const;
+		// Same as DoesHit for the shadow ray of a primary hit towards lights[lightIndex]
+		bool DoesHitLight(size_t lightIndex, const Ray& hitToLight) const { return DoesHitLight(lightIndex, hitToLight, m_ViewTerms); }
+		bool DoesHitLight(size_t lightIndex, const Ray& hitToLight, const ViewTerms& viewTerms) const;
+		// Terms of the scene's own view, from the single-camera Update functions
+		const ViewTerms& GetViewTerms() const { return m_ViewTerms; }
 
 		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
+		const std::vector<TriangleMesh>& GetTriangleMeshGeometries() const { return m_TriangleMeshGeometries; }
 		const std::vector<Light>& GetLights() const { return m_Lights; }
-		const std::vector<Material*> GetMaterials() const { return m_Materials; }
+		const std::vector<Material*>& GetMaterials() const { return m_Materials; }
+
+		void SetLightColor(size_t lightIndex, const ColorRGB& color);
+		void SetLightIntensity(size_t lightIndex, float intensity);
+		void ScaleLightIntensities(float factor);
+
+		// Before Initialize: load meshes through their binary cache (MeshCache) and write it when missing
+		void SetUseMeshCache(bool useMeshCache) { m_UseMeshCache = useMeshCache; }
+		// Before Initialize: weld, clean up and reorder loaded meshes (MeshOptimizer)
+		void SetOptimizeMeshes(bool optimizeMeshes) { m_OptimizeMeshes = optimizeMeshes; }
+		// Before Initialize: meshes keep their transformed vertices compact (TriangleMesh::useCompactVertices)
+		void SetUseCompactVertices(bool useCompactVertices) { m_UseCompactVertices = useCompactVertices; }
 
 	protected:
 		std::string	sceneName;
@@ -56,9 +92,27 @@ namespace dae
 
 		Camera m_Camera{};
 
+		ViewTerms m_ViewTerms{};
+		bool m_UseMeshCache{ true };
+		bool m_OptimizeMeshes{ true };
+		bool m_UseCompactVertices{ false };
+
+		// Change tracking, bump when modifying a container after Initialize
+		uint32_t m_SphereVersion{};
+		uint32_t m_PlaneVersion{};
+		uint32_t m_TriangleMeshVersion{};
+		uint32_t m_LightVersion{};
+		uint32_t m_LightColorVersion{};
+		uint32_t m_MaterialVersion{};
+
 		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
 		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		// Mesh file into the positions, indices, face normals and BVH of the mesh (MeshLoader::LoadTriangleMesh), logs the load speed
+		bool LoadTriangleMesh(TriangleMesh* pMesh, const std::string& path);
+		// Every node instance of a .glb as a triangle mesh sharing the primitive's geometry (TriangleMesh::pInstancedMesh),
+		// with a Material_CookTorrence per glTF material, logs the load speed
+		bool LoadGltfScene(const std::string& path);
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
@@ -188,4 +242,28 @@ namespace dae
 	private:
 		TriangleMesh* pMesh{ nullptr };
 	};
+
+	//+++++++++++++++++++++++++++++++++++++++++
+	//glTF binary file, camera and lights framed around whatever it contains
+	class GltfScene final : public Scene
+	{
+	public:
+		GltfScene(const std::string& path);
+		~GltfScene() override = default;
+
+		GltfScene(const GltfScene&) = delete;
+		GltfScene(GltfScene&&) noexcept = delete;
+		GltfScene& operator=(const GltfScene&) = delete;
+		GltfScene& operator=(GltfScene&&) noexcept = delete;
+
+		void Initialize() override;
+
+	private:
+		std::string m_Path{};
+	};
+
+	//+++++++++++++++++++++++++++++++++++++++++
+	//Scene by class name (e.g. "ReferenceScene_W4") or path of a .glb, nullptr when unknown. Not initialized yet.
+	Scene* CreateScene(const std::string& sceneName);
+	const std::vector<std::string>& GetSceneNames();
 }
@@ -0,0 +1,166 @@
+#include <algorithm>
+
+#include "ScenePartition.h"
+#include "Scene.h"
+#include "Utils.h"
+
+namespace dae {
+
+	void ScenePartition::Build(const Scene& scene, size_t partitionCount, std::vector<ScenePartition>& partitions)
+	{
+		partitions.clear();
+		partitions.resize(std::max(partitionCount, size_t{ 1 }));
+
+		// Planes are infinite and cheap, give them to the first worker so they're only tested once
+		for (const Plane& plane : scene.GetPlaneGeometries())
+		{
+			partitions[0].m_Planes.push_back(plane);
+			++partitions[0].m_PrimitiveCount;
+		}
+
+		// Always hand the next object to the least loaded worker
+		auto getLeastLoaded = [&partitions]() -> ScenePartition&
+		{
+			return *std::min_element(partitions.begin(), partitions.end(),
+				[](const ScenePartition& a, const ScenePartition& b) { return a.m_PrimitiveCount < b.m_PrimitiveCount; });
+		};
+
+		// Meshes first (biggest), then fill up with spheres
+		const std::vector<TriangleMesh>& meshes{ scene.GetTriangleMeshGeometries() };
+		for (size_t meshIdx{}; meshIdx < meshes.size(); ++meshIdx)
+		{
+			ScenePartition& partition{ getLeastLoaded() };
+			partition.CopyMesh(meshes[meshIdx], partition.m_TriangleMeshes.emplace_back());
+			partition.m_SourceMeshIndices.push_back(meshIdx);
+			partition.m_PrimitiveCount += meshes[meshIdx].GetGeometry().GetTriangleCount();
+		}
+
+		for (const Sphere& sphere : scene.GetSphereGeometries())
+		{
+			ScenePartition& partition{ getLeastLoaded() };
+			partition.m_Spheres.push_back(sphere);
+			++partition.m_PrimitiveCount;
+		}
+	}
+
+	void ScenePartition::UpdateMeshes(const Scene& scene)
+	{
+		const std::vector<TriangleMesh>& meshes{ scene.GetTriangleMeshGeometries() };
+		for (size_t idx{}; idx < m_TriangleMeshes.size(); ++idx)
+		{
+			const TriangleMesh& source{ meshes[m_SourceMeshIndices[idx]] };
+			if (source.version != m_TriangleMeshes[idx].version)
+			{
+				CopyMesh(source, m_TriangleMeshes[idx]);
+			}
+		}
+	}
+
+	void ScenePartition::CopyMesh(const TriangleMesh& source, TriangleMesh& mesh)
+	{
+		mesh = source;
+		if (!source.pInstancedMesh)
+		{
+			return;
+		}
+
+		// Instances would still point at the scene's shared mesh, they get the one of this partition
+		std::shared_ptr<const TriangleMesh>& pInstancedMesh{ m_InstancedMeshes[source.pInstancedMesh.get()] };
+		if (!pInstancedMesh)
+		{
+			pInstancedMesh = std::make_shared<const TriangleMesh>(*source.pInstancedMesh);
+		}
+		mesh.pInstancedMesh = pInstancedMesh;
+	}
+
+	void ScenePartition::TraceClosest(const Ray* pRays, size_t rayCount, PartitionFragment* pFragments) const
+	{
+		for (size_t rayIdx{}; rayIdx < rayCount; ++rayIdx)
+		{
+			const Ray& ray{ pRays[rayIdx] };
+			HitRecord closestHit{};
+
+			// The hit tests keep t on a miss, a record shared between rays would hand out hits of the previous ones
+			HitRecord tempHitRecord{};
+
+			// Spheres
+			for (const Sphere& sphere : m_Spheres)
+			{
+				GeometryUtils::HitTest_Sphere(sphere, ray, tempHitRecord);
+				if (tempHitRecord.t < closestHit.t && tempHitRecord.t >= 0)
+				{
+					closestHit = tempHitRecord;
+				}
+			}
+
+			// Planes
+			for (const Plane& plane : m_Planes)
+			{
+				GeometryUtils::HitTest_Plane(plane, ray, tempHitRecord);
+				if (tempHitRecord.t < closestHit.t && tempHitRecord.t >= 0)
+				{
+					closestHit = tempHitRecord;
+				}
+			}
+
+			// Triangles
+			for (const TriangleMesh& mesh : m_TriangleMeshes)
+			{
+				GeometryUtils::HitTest_TriangleMesh(mesh, ray, tempHitRecord);
+				if (tempHitRecord.t < closestHit.t && tempHitRecord.t >= 0)
+				{
+					closestHit = tempHitRecord;
+				}
+			}
+
+			// Only send back what the coordinator needs, hitpoint is rebuilt from the depth
+			PartitionFragment& fragment{ pFragments[rayIdx] };
+			fragment = PartitionFragment{};
+			if (closestHit.didHit)
+			{
+				fragment.depth = closestHit.t;
+				fragment.normal = closestHit.normal;
+				fragment.materialIndex = closestHit.materialIndex;
+			}
+		}
+	}
+
+	void ScenePartition::TraceOcclusion(const Ray* pRays, size_t rayCount, uint8_t* pOccluded) const
+	{
+		HitRecord tempHitRecord{};
+		for (size_t rayIdx{}; rayIdx < rayCount; ++rayIdx)
+		{
+			pOccluded[rayIdx] = 0;
+			if (!(pRays[rayIdx].max > pRays[rayIdx].min))
+			{
+				continue;
+			}
+
+			// Same offset as Scene::DoesHit
+			Ray adjustedRay{ pRays[rayIdx] };
+			adjustedRay.origin = adjustedRay.origin + 0.0001f * adjustedRay.direction;
+
+			bool isOccluded{ false };
+
+			// Spheres
+			for (size_t idx{}; idx < m_Spheres.size() && !isOccluded; ++idx)
+			{
+				isOccluded = GeometryUtils::HitTest_Sphere(m_Spheres[idx], adjustedRay, tempHitRecord, true);
+			}
+
+			// Planes
+			for (size_t idx{}; idx < m_Planes.size() && !isOccluded; ++idx)
+			{
+				isOccluded = GeometryUtils::HitTest_Plane(m_Planes[idx], adjustedRay, tempHitRecord, true);
+			}
+
+			// Triangles
+			for (size_t idx{}; idx < m_TriangleMeshes.size() && !isOccluded; ++idx)
+			{
+				isOccluded = GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshes[idx], adjustedRay, tempHitRecord, true);
+			}
+
+			pOccluded[rayIdx] = isOccluded;
+		}
+	}
+}
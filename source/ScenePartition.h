@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include "Math.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Forward Declarations
+	class Scene;
+
+	//Per-pixel result a partition worker sends back after the primary round
+	struct PartitionFragment
+	{
+		float depth{ FLT_MAX };
+		Vector3 normal{};
+		unsigned char materialIndex{ 0 };
+	};
+
+	//Copy of the scene objects owned by one (sort-last) worker. Rays go in and fragments or occlusion flags come out
+	//as flat arrays of plain structs, a worker never reads the scene itself.
+	//The workers are threads of this process for now, the coordinator (Renderer) still holds the whole scene
+	class ScenePartition final
+	{
+	public:
+		ScenePartition() = default;
+		~ScenePartition() = default;
+
+		ScenePartition(const ScenePartition&) = delete;
+		ScenePartition(ScenePartition&&) noexcept = default;
+		ScenePartition& operator=(const ScenePartition&) = delete;
+		ScenePartition& operator=(ScenePartition&&) noexcept = default;
+
+		/**
+		 * \brief Splits the spheres and triangle meshes of a scene over a number of partitions,
+		 *		  balanced on primitive count. Planes are kept by the first partition only.
+		 *		  Every partition copies its objects, instances get a copy of their shared mesh per partition.
+		 * \param scene scene to split
+		 * \param partitionCount amount of workers
+		 * \param partitions output, resized to partitionCount
+		 */
+		static void Build(const Scene& scene, size_t partitionCount, std::vector<ScenePartition>& partitions);
+
+		// Copies the meshes again whose version changed, the scene must still have the objects Build split
+		void UpdateMeshes(const Scene& scene);
+
+		// Round 1: closest hit of every ray against this partition only
+		void TraceClosest(const Ray* pRays, size_t rayCount, PartitionFragment* pFragments) const;
+		// Round 2: occlusion of every (shadow) ray against this partition only, rays with max <= min are skipped
+		void TraceOcclusion(const Ray* pRays, size_t rayCount, uint8_t* pOccluded) const;
+
+		size_t GetPrimitiveCount() const { return m_PrimitiveCount; }
+
+	private:
+		std::vector<Sphere> m_Spheres{};
+		std::vector<Plane> m_Planes{};
+		std::vector<TriangleMesh> m_TriangleMeshes{};
+		std::vector<size_t> m_SourceMeshIndices{}; // Scene index of every mesh in m_TriangleMeshes
+
+		// Own copy of every mesh the instances of this partition share, by the scene's shared mesh
+		std::unordered_map<const TriangleMesh*, std::shared_ptr<const TriangleMesh>> m_InstancedMeshes{};
+
+		size_t m_PrimitiveCount{};
+
+		void CopyMesh(const TriangleMesh& source, TriangleMesh& mesh);
+	};
+}
@@ -0,0 +1,118 @@
+//Standard includes
+#include <algorithm>
+
+//Project includes
+#include "ThreadPool.h"
+
+namespace dae {
+
+	ThreadPool::ThreadPool(int threadCount)
+	{
+		SetThreadCount(threadCount);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		StopWorkers();
+	}
+
+	void ThreadPool::SetThreadCount(int threadCount)
+	{
+		threadCount = std::max(threadCount, 1);
+		if (threadCount == m_ThreadCount && m_Workers.size() == static_cast<size_t>(threadCount - 1))
+		{
+			return;
+		}
+
+		StopWorkers();
+		m_ThreadCount = threadCount;
+
+		m_Workers.reserve(m_ThreadCount - 1);
+		for (int idx{ 1 }; idx < m_ThreadCount; ++idx)
+		{
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, m_Generation);
+		}
+	}
+
+	void ThreadPool::ForEachJob(int jobCount, const std::function<void(int)>& job)
+	{
+		// Nothing to share, or the workers are already busy with another batch
+		if (m_Workers.empty() || jobCount <= 1 || m_IsRunning.exchange(true))
+		{
+			for (int jobIdx{}; jobIdx < jobCount; ++jobIdx)
+			{
+				job(jobIdx);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_pJob = &job;
+			m_JobCount = jobCount;
+			m_NextJob = 0;
+			m_BusyWorkers = static_cast<int>(m_Workers.size());
+			++m_Generation;
+		}
+		m_WorkReady.notify_all();
+
+		// Calling thread helps as well
+		RunJobs();
+
+		// Every worker has to be done with the batch before job goes out of scope
+		{
+			std::unique_lock lock{ m_Mutex };
+			m_WorkDone.wait(lock, [this]() { return m_BusyWorkers == 0; });
+			m_pJob = nullptr;
+		}
+		m_IsRunning = false;
+	}
+
+	void ThreadPool::WorkerLoop(uint64_t generation)
+	{
+		std::unique_lock lock{ m_Mutex };
+		while (true)
+		{
+			m_WorkReady.wait(lock, [&]() { return m_IsStopping || m_Generation != generation; });
+			if (m_IsStopping)
+			{
+				return;
+			}
+
+			generation = m_Generation;
+			lock.unlock();
+			RunJobs();
+			lock.lock();
+
+			if (--m_BusyWorkers == 0)
+			{
+				m_WorkDone.notify_one();
+			}
+		}
+	}
+
+	void ThreadPool::RunJobs()
+	{
+		for (int jobIdx{ m_NextJob++ }; jobIdx < m_JobCount; jobIdx = m_NextJob++)
+		{
+			(*m_pJob)(jobIdx);
+		}
+	}
+
+	void ThreadPool::StopWorkers()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_WorkReady.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+
+		m_Workers.clear();
+		m_IsStopping = false;
+	}
+}
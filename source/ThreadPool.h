@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	//Worker threads that stay alive between calls, ForEachJob only wakes them instead of starting new ones
+	class ThreadPool final
+	{
+	public:
+		ThreadPool(int threadCount = 1);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		// Threads including the calling one, the workers are started (or stopped) here
+		void SetThreadCount(int threadCount);
+		int GetThreadCount() const { return m_ThreadCount; }
+
+		/**
+		 * \brief Runs job(0) to job(jobCount - 1) and returns when all of them are done, the calling thread helps.
+		 *		  Threads pick the next free job, keeps them busy when some jobs are more expensive.
+		 *		  A call made while the pool is busy (from inside a job, or from another thread) runs on the calling thread only
+		 */
+		void ForEachJob(int jobCount, const std::function<void(int)>& job);
+
+	private:
+		int m_ThreadCount{ 1 };
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WorkReady{};
+		std::condition_variable m_WorkDone{};
+		uint64_t m_Generation{}; // Goes up for every batch of jobs
+		int m_BusyWorkers{};
+		bool m_IsStopping{ false };
+
+		const std::function<void(int)>* m_pJob{};
+		int m_JobCount{};
+		std::atomic<int> m_NextJob{};
+		std::atomic<bool> m_IsRunning{ false };
+
+		void WorkerLoop(uint64_t generation);
+		void RunJobs();
+		void StopWorkers();
+	};
+}
@@ -0,0 +1,228 @@
+//External includes
+#ifndef RAYTRACER_HEADLESS
+#include "SDL_pixels.h"
+#endif
+
+//Standard includes
+#include <algorithm>
+#include <cmath>
+
+//Project includes
+#include "ToneMapper.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define TONEMAPPER_SSE
+#include <emmintrin.h>
+#endif
+
+namespace dae {
+
+	static_assert(sizeof(ColorRGB) == 3 * sizeof(float), "ColorRGB buffers are read as packed floats");
+
+#ifndef RAYTRACER_HEADLESS
+	void ToneMapper::SetPixelFormat(const SDL_PixelFormat* pFormat)
+	{
+		m_pFormat = pFormat;
+
+		// Anything that isn't 4 bytes with 8 bit color channels goes through SDL_MapRGB
+		m_CanPack = pFormat->BytesPerPixel == 4 && pFormat->Rloss == 0 && pFormat->Gloss == 0 && pFormat->Bloss == 0;
+		m_ShiftR = pFormat->Rshift;
+		m_ShiftG = pFormat->Gshift;
+		m_ShiftB = pFormat->Bshift;
+		m_AlphaMask = pFormat->Amask;
+	}
+#endif
+
+	void ToneMapper::SetChannelLayout(uint32_t shiftR, uint32_t shiftG, uint32_t shiftB, uint32_t alphaMask)
+	{
+		m_pFormat = nullptr;
+		m_CanPack = true;
+		m_ShiftR = shiftR;
+		m_ShiftG = shiftG;
+		m_ShiftB = shiftB;
+		m_AlphaMask = alphaMask;
+	}
+
+	void ToneMapper::Unpack(uint32_t pixel, uint8_t& r, uint8_t& g, uint8_t& b) const
+	{
+#ifndef RAYTRACER_HEADLESS
+		if (!m_CanPack)
+		{
+			SDL_GetRGB(pixel, m_pFormat, &r, &g, &b);
+			return;
+		}
+#endif
+		r = static_cast<uint8_t>(pixel >> m_ShiftR);
+		g = static_cast<uint8_t>(pixel >> m_ShiftG);
+		b = static_cast<uint8_t>(pixel >> m_ShiftB);
+	}
+
+	void ToneMapper::SetGamma(float gamma)
+	{
+		m_Gamma = gamma;
+
+		m_GammaLut.resize(m_LutSize);
+		for (int idx{}; idx < m_LutSize; ++idx)
+		{
+			const float value{ std::pow(float(idx) / (m_LutSize - 1), 1.f / gamma) };
+			m_GammaLut[idx] = static_cast<uint8_t>(value * 255 + 0.5f);
+		}
+	}
+
+	void ToneMapper::Apply(const ColorRGB* pColors, uint32_t* pPixels, size_t count) const
+	{
+		size_t pixelIdx{};
+
+#ifdef TONEMAPPER_SSE
+		if (m_CanPack)
+		{
+			const __m128 zero{ _mm_setzero_ps() };
+			const __m128 one{ _mm_set1_ps(1.f) };
+			const bool useLut{ m_Gamma != 1.f };
+			const __m128 scale{ _mm_set1_ps(useLut ? float(m_LutSize - 1) : 255.f) };
+			const __m128 bias{ _mm_set1_ps(useLut ? 0.5f : 0.f) };
+
+			const __m128i shiftR{ _mm_cvtsi32_si128(static_cast<int>(m_ShiftR)) };
+			const __m128i shiftG{ _mm_cvtsi32_si128(static_cast<int>(m_ShiftG)) };
+			const __m128i shiftB{ _mm_cvtsi32_si128(static_cast<int>(m_ShiftB)) };
+			const __m128i alpha{ _mm_set1_epi32(static_cast<int>(m_AlphaMask)) };
+
+			for (; pixelIdx + 4 <= count; pixelIdx += 4)
+			{
+				// r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3 >> rrrr gggg bbbb
+				const float* pData{ &pColors[pixelIdx].r };
+				const __m128 a{ _mm_loadu_ps(pData) };
+				const __m128 b{ _mm_loadu_ps(pData + 4) };
+				const __m128 c{ _mm_loadu_ps(pData + 8) };
+
+				__m128 red{ _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0)) };
+				__m128 green{ _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)) };
+				__m128 blue{ _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)) };
+
+				switch (m_Operator)
+				{
+				case ToneMapOperator::MaxToOne:
+				{
+					const __m128 maxValue{ _mm_max_ps(one, _mm_max_ps(red, _mm_max_ps(green, blue))) };
+					red = _mm_div_ps(red, maxValue);
+					green = _mm_div_ps(green, maxValue);
+					blue = _mm_div_ps(blue, maxValue);
+					break;
+				}
+				case ToneMapOperator::Reinhard:
+				{
+					const __m128 luminance{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(red, _mm_set1_ps(0.2126f)), _mm_mul_ps(green, _mm_set1_ps(0.7152f))), _mm_mul_ps(blue, _mm_set1_ps(0.0722f))) };
+					const __m128 factor{ _mm_div_ps(one, _mm_add_ps(one, luminance)) };
+					red = _mm_mul_ps(red, factor);
+					green = _mm_mul_ps(green, factor);
+					blue = _mm_mul_ps(blue, factor);
+					break;
+				}
+				case ToneMapOperator::ACES:
+				{
+					auto aces = [](__m128 x)
+					{
+						const __m128 numerator{ _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f))) };
+						const __m128 denominator{ _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f)) };
+						return _mm_div_ps(numerator, denominator);
+					};
+					red = aces(red);
+					green = aces(green);
+					blue = aces(blue);
+					break;
+				}
+				default:
+					break;
+				}
+
+				// Clamp and quantize, truncation like the old static_cast<uint8_t>(color * 255)
+				const __m128i redInt{ _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(red, zero), one), scale), bias)) };
+				const __m128i greenInt{ _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(green, zero), one), scale), bias)) };
+				const __m128i blueInt{ _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(blue, zero), one), scale), bias)) };
+
+				if (useLut)
+				{
+					alignas(16) int32_t redIdx[4], greenIdx[4], blueIdx[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(redIdx), redInt);
+					_mm_store_si128(reinterpret_cast<__m128i*>(greenIdx), greenInt);
+					_mm_store_si128(reinterpret_cast<__m128i*>(blueIdx), blueInt);
+
+					for (int lane{}; lane < 4; ++lane)
+					{
+						pPixels[pixelIdx + lane] = Pack(m_GammaLut[redIdx[lane]], m_GammaLut[greenIdx[lane]], m_GammaLut[blueIdx[lane]]);
+					}
+					continue;
+				}
+
+				const __m128i packed{ _mm_or_si128(_mm_or_si128(_mm_sll_epi32(redInt, shiftR), _mm_sll_epi32(greenInt, shiftG)),
+												   _mm_or_si128(_mm_sll_epi32(blueInt, shiftB), alpha)) };
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pPixels + pixelIdx), packed);
+			}
+		}
+#endif
+
+		// Remainder (or everything without SSE or a packable format)
+		ApplyScalar(pColors + pixelIdx, pPixels + pixelIdx, count - pixelIdx);
+	}
+
+	uint32_t ToneMapper::Pack(uint32_t r, uint32_t g, uint32_t b) const
+	{
+		return (r << m_ShiftR) | (g << m_ShiftG) | (b << m_ShiftB) | m_AlphaMask;
+	}
+
+	ColorRGB ToneMapper::ToneMap(ColorRGB color) const
+	{
+		switch (m_Operator)
+		{
+		case ToneMapOperator::MaxToOne:
+			color.MaxToOne();
+			break;
+		case ToneMapOperator::Reinhard:
+			color *= 1.f / (1.f + color.GetLuminance());
+			break;
+		case ToneMapOperator::ACES:
+		{
+			auto aces = [](float x) { return (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f); };
+			color = ColorRGB{ aces(color.r), aces(color.g), aces(color.b) };
+			break;
+		}
+		default:
+			break;
+		}
+
+		color.r = std::clamp(color.r, 0.f, 1.f);
+		color.g = std::clamp(color.g, 0.f, 1.f);
+		color.b = std::clamp(color.b, 0.f, 1.f);
+		return color;
+	}
+
+	void ToneMapper::ApplyScalar(const ColorRGB* pColors, uint32_t* pPixels, size_t count) const
+	{
+		const bool useLut{ m_Gamma != 1.f };
+		auto quantize = [&](float value) -> uint32_t
+		{
+			if (useLut)
+			{
+				return m_GammaLut[static_cast<int>(value * (m_LutSize - 1) + 0.5f)];
+			}
+			return static_cast<uint8_t>(value * 255);
+		};
+
+		for (size_t pixelIdx{}; pixelIdx < count; ++pixelIdx)
+		{
+			const ColorRGB color{ ToneMap(pColors[pixelIdx]) };
+			const uint32_t r{ quantize(color.r) };
+			const uint32_t g{ quantize(color.g) };
+			const uint32_t b{ quantize(color.b) };
+
+#ifndef RAYTRACER_HEADLESS
+			if (!m_CanPack)
+			{
+				pPixels[pixelIdx] = SDL_MapRGB(m_pFormat, static_cast<uint8_t>(r), static_cast<uint8_t>(g), static_cast<uint8_t>(b));
+				continue;
+			}
+#endif
+			pPixels[pixelIdx] = Pack(r, g, b);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ColorRGB.h"
+
+struct SDL_PixelFormat;
+
+namespace dae
+{
+	enum class ToneMapOperator
+	{
+		Clamp,		// Cut off everything above 1
+		MaxToOne,	// Scale down so the biggest channel is 1 (keeps the hue)
+		Reinhard,	// L / (1 + L) on the luminance
+		ACES		// Filmic curve (Narkowicz fit)
+	};
+
+	//Linear HDR colors to the pixels of a surface, in one pass over the buffer
+	class ToneMapper final
+	{
+	public:
+		ToneMapper() = default;
+		~ToneMapper() = default;
+
+		ToneMapper(const ToneMapper&) = delete;
+		ToneMapper(ToneMapper&&) noexcept = delete;
+		ToneMapper& operator=(const ToneMapper&) = delete;
+		ToneMapper& operator=(ToneMapper&&) noexcept = delete;
+
+#ifndef RAYTRACER_HEADLESS
+		// Reads the channel layout, 32 bit formats with 8 bit channels are packed directly
+		void SetPixelFormat(const SDL_PixelFormat* pFormat);
+#endif
+		// 32 bit pixels with 8 bit channels at the given shifts
+		void SetChannelLayout(uint32_t shiftR, uint32_t shiftG, uint32_t shiftB, uint32_t alphaMask);
+		// Channels of a packed pixel
+		void Unpack(uint32_t pixel, uint8_t& r, uint8_t& g, uint8_t& b) const;
+
+		void SetOperator(ToneMapOperator toneMapOperator) { m_Operator = toneMapOperator; }
+		ToneMapOperator GetOperator() const { return m_Operator; }
+		void SetGamma(float gamma);
+		float GetGamma() const { return m_Gamma; }
+
+		// Tone maps, applies gamma and packs count pixels
+		void Apply(const ColorRGB* pColors, uint32_t* pPixels, size_t count) const;
+
+	private:
+		const SDL_PixelFormat* m_pFormat{};
+		bool m_CanPack{};
+		uint32_t m_ShiftR{};
+		uint32_t m_ShiftG{};
+		uint32_t m_ShiftB{};
+		uint32_t m_AlphaMask{};
+
+		ToneMapOperator m_Operator{ ToneMapOperator::MaxToOne };
+		float m_Gamma{ 1.f };
+
+		// [0, 1] in LutSize steps to 8 bit, only used when gamma != 1
+		static constexpr int m_LutSize{ 4096 };
+		std::vector<uint8_t> m_GammaLut{};
+
+		uint32_t Pack(uint32_t r, uint32_t g, uint32_t b) const;
+		ColorRGB ToneMap(ColorRGB color) const;
+		void ApplyScalar(const ColorRGB* pColors, uint32_t* pPixels, size_t count) const;
+	};
+}
@@ -1,6 +1,5 @@
 #pragma once
 #include <cassert>
-#include <fstream>
 #include "Math.h"
 #include "DataTypes.h"
 
@@ -10,17 +9,21 @@ namespace dae
 	{
 #pragma region Sphere HitTest
 		//SPHERE HIT-TESTS
-		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline SphereOriginTerms GetOriginTerms(const Sphere& sphere, const Vector3& rayOrigin)
+		{
+			const Vector3 sphereToRay{ rayOrigin - sphere.origin };
+			return SphereOriginTerms{ sphereToRay, Vector3::Dot(sphereToRay,sphereToRay) - (sphere.radius * sphere.radius) };
+		}
+
+		inline bool HitTest_Sphere(const Sphere& sphere, const SphereOriginTerms& originTerms, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
 			//todo W1
 
 			const Vector3 rayDirection{ ray.direction };
-			const Vector3 sphereToRay{ ray.origin - sphere.origin };
-			const float sphereRadius{ sphere.radius };
 
 			const float A{ Vector3::Dot(rayDirection,rayDirection) };
-			const float B{ Vector3::Dot(2 * rayDirection,sphereToRay) };
-			const float C{ Vector3::Dot(sphereToRay,sphereToRay) - (sphereRadius * sphereRadius) };
+			const float B{ Vector3::Dot(2 * rayDirection,originTerms.sphereToRay) };
+			const float C{ originTerms.C };
 
 			// When no hits
 			const float discriminant{ (B * B) - 4 * A * C };
@@ -81,6 +84,11 @@ namespace dae
 			return true;
 		}
 
+		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		{
+			return HitTest_Sphere(sphere, GetOriginTerms(sphere, ray.origin), ray, hitRecord, ignoreHitRecord);
+		}
+
 		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray)
 		{
 			HitRecord temp{};
@@ -89,12 +97,16 @@ namespace dae
 #pragma endregion
 #pragma region Plane HitTest
 		//PLANE HIT-TESTS
-		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline PlaneOriginTerms GetOriginTerms(const Plane& plane, const Vector3& rayOrigin)
+		{
+			return PlaneOriginTerms{ Vector3::Dot(plane.origin - rayOrigin,plane.normal) };
+		}
+
+		inline bool HitTest_Plane(const Plane& plane, const PlaneOriginTerms& originTerms, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
 			//todo W1
 
-			const Vector3 rayToPlane{ plane.origin - ray.origin };
-			const float distanceToPlane{ Vector3::Dot(rayToPlane,plane.normal) / Vector3::Dot(ray.direction,plane.normal) };
+			const float distanceToPlane{ originTerms.rayToPlaneDot / Vector3::Dot(ray.direction,plane.normal) };
 			
 			const bool isInsideBoundaries{ ray.min < distanceToPlane && distanceToPlane < ray.max };
 			if (!isInsideBoundaries)
@@ -117,6 +129,11 @@ namespace dae
 			return true;
 		}
 
+		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		{
+			return HitTest_Plane(plane, GetOriginTerms(plane, ray.origin), ray, hitRecord, ignoreHitRecord);
+		}
+
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray)
 		{
 			HitRecord temp{};
@@ -230,9 +247,132 @@ namespace dae
 		}
 #pragma endregion
 #pragma region TriangeMesh HitTest
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		//Slab test of a BVH node against [tMin, tMax] of the ray
+		inline bool HitTest_BVHNode(const BVHNode& node, const Vector3& origin, const Vector3& inverseDirection, float tMin, float tMax)
+		{
+			for (int axis{}; axis < 3; ++axis)
+			{
+				float t0{ (node.minAABB[axis] - origin[axis]) * inverseDirection[axis] };
+				float t1{ (node.maxAABB[axis] - origin[axis]) * inverseDirection[axis] };
+
+				if (t0 > t1) std::swap(t0, t1);
+
+				tMin = std::max(tMin, t0);
+				tMax = std::min(tMax, t1);
+				if (tMin > tMax)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		//Transformed vertices of a mesh as floats
+		struct FloatVertices
+		{
+			const Vector3* pPositions;
+			const Vector3* pNormals;
+
+			explicit FloatVertices(const TriangleMesh& mesh) : pPositions{ mesh.transformedPositions.data() }, pNormals{ mesh.transformedNormals.data() } {}
+
+			Vector3 GetPosition(size_t idx) const { return pPositions[idx]; }
+			Vector3 GetNormal(size_t triangleIdx) const { return pNormals[triangleIdx]; }
+		};
+
+		//Transformed vertices of a mesh with useCompactVertices, decoded per triangle
+		struct CompactVertices
+		{
+			const CompactPosition* pPositions;
+			const uint32_t* pNormals;
+			Vector3 origin;
+			Vector3 step;
+
+			explicit CompactVertices(const TriangleMesh& mesh) : pPositions{ mesh.compactPositions.data() }, pNormals{ mesh.compactNormals.data() },
+				origin{ mesh.compactOrigin }, step{ mesh.compactStep } {}
+
+			Vector3 GetPosition(size_t idx) const { return VertexEncoding::DecodePosition(pPositions[idx], origin, step); }
+			Vector3 GetNormal(size_t triangleIdx) const { return VertexEncoding::DecodeNormal(pNormals[triangleIdx]); }
+		};
+
+		//Same hit as testing every triangle: equal distances go to the lowest triangle index
+		//pIndices is mesh.indices or mesh.compactIndices, vertices FloatVertices or CompactVertices
+		template<typename Index, typename Vertices>
+		inline bool HitTest_TriangleMeshBVH(const TriangleMesh& mesh, const Index* pIndices, const Vertices& vertices, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord)
+		{
+			Triangle currentTriangle{};
+			currentTriangle.materialIndex = mesh.materialIndex;
+			currentTriangle.cullMode = mesh.cullMode;
+
+			const Vector3 inverseDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+
+			HitRecord tempHitRecord{};
+			HitRecord closestRecord{};
+			uint32_t closestTriangleIdx{ UINT32_MAX };
+
+			// Deep enough for the depth limit of MeshBVH::Build
+			uint32_t nodeStack[96];
+			int stackSize{};
+			nodeStack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const BVHNode& node{ mesh.bvhNodes[nodeStack[--stackSize]] };
+				if (!HitTest_BVHNode(node, ray.origin, inverseDirection, ray.min, std::min(ray.max, closestRecord.t)))
+				{
+					continue;
+				}
+
+				if (node.triangleCount == 0)
+				{
+					nodeStack[stackSize++] = node.firstIdx + 1;
+					nodeStack[stackSize++] = node.firstIdx;
+					continue;
+				}
+
+				for (uint32_t idx{ node.firstIdx }; idx < node.firstIdx + node.triangleCount; ++idx)
+				{
+					const uint32_t triangleIdx{ mesh.bvhTriangles[idx] };
+					currentTriangle.v0 = vertices.GetPosition(pIndices[triangleIdx * 3]);
+					currentTriangle.v1 = vertices.GetPosition(pIndices[triangleIdx * 3 + 1]);
+					currentTriangle.v2 = vertices.GetPosition(pIndices[triangleIdx * 3 + 2]);
+					currentTriangle.normal = vertices.GetNormal(triangleIdx);
+
+					HitTest_Triangle(currentTriangle, ray, tempHitRecord);
+					if (!tempHitRecord.didHit || tempHitRecord.t < 0)
+					{
+						continue;
+					}
+
+					if (tempHitRecord.t < closestRecord.t || (tempHitRecord.t == closestRecord.t && triangleIdx < closestTriangleIdx))
+					{
+						closestRecord = tempHitRecord;
+						closestTriangleIdx = triangleIdx;
+
+						// Occlusion only needs any hit
+						if (ignoreHitRecord)
+						{
+							hitRecord = closestRecord;
+							return true;
+						}
+					}
+				}
+			}
+
+			if (closestRecord.didHit)
+			{
+				hitRecord = closestRecord;
+				return true;
+			}
+
+			hitRecord.didHit = false;
+			return false;
+		}
+
+		//Every triangle, for meshes without a BVH
+		template<typename Index, typename Vertices>
+		inline bool HitTest_TriangleMeshAll(const TriangleMesh& mesh, const Index* pIndices, const Vertices& vertices, const Ray& ray, HitRecord& hitRecord)
 		{
-			//todo W5
 			Triangle currentTriangle{};
 			currentTriangle.materialIndex = mesh.materialIndex;
 			currentTriangle.cullMode = mesh.cullMode;
@@ -241,13 +381,13 @@ namespace dae
 			HitRecord tempHitRecord{};
 			HitRecord closestRecord{};
 
-			for (size_t idx{}; idx < mesh.indices.size(); idx += 3)
+			for (size_t idx{}; idx < mesh.GetIndexCount(); idx += 3)
 			{
-				currentTriangle.v0 = mesh.transformedPositions[mesh.indices[idx]];
-				currentTriangle.v1 = mesh.transformedPositions[mesh.indices[idx + 1]];
-				currentTriangle.v2 = mesh.transformedPositions[mesh.indices[idx + 2]];
+				currentTriangle.v0 = vertices.GetPosition(pIndices[idx]);
+				currentTriangle.v1 = vertices.GetPosition(pIndices[idx + 1]);
+				currentTriangle.v2 = vertices.GetPosition(pIndices[idx + 2]);
 
-				currentTriangle.normal = mesh.transformedNormals[trianglesChecked];
+				currentTriangle.normal = vertices.GetNormal(trianglesChecked);
 
 				HitTest_Triangle(currentTriangle, ray, tempHitRecord);
 				if (tempHitRecord.didHit)
@@ -274,11 +414,71 @@ namespace dae
 			}
 		}
 
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		{
+			//todo W5
+			// Instances test the shared mesh with the ray in its space. The direction isn't normalized there, so t stays the world distance
+			if (mesh.pInstancedMesh)
+			{
+				Ray instanceRay{ ray };
+				instanceRay.origin = mesh.worldToInstance.TransformPoint(ray.origin);
+				instanceRay.direction = mesh.worldToInstance.TransformVector(ray.direction);
+				if (!HitTest_TriangleMesh(*mesh.pInstancedMesh, instanceRay, hitRecord, ignoreHitRecord))
+				{
+					return false;
+				}
+
+				hitRecord.origin = ray.origin + hitRecord.t * ray.direction;
+				hitRecord.normal = mesh.instanceNormalTransform.TransformVector(hitRecord.normal).Normalized();
+				hitRecord.materialIndex = mesh.materialIndex;
+				return true;
+			}
+
+			const auto hitTest = [&](const auto* pIndices, const auto& vertices)
+			{
+				return mesh.bvhNodes.empty() ? HitTest_TriangleMeshAll(mesh, pIndices, vertices, ray, hitRecord)
+					: HitTest_TriangleMeshBVH(mesh, pIndices, vertices, ray, hitRecord, ignoreHitRecord);
+			};
+			const auto hitTestVertices = [&](const auto* pIndices)
+			{
+				return mesh.useCompactVertices ? hitTest(pIndices, CompactVertices{ mesh }) : hitTest(pIndices, FloatVertices{ mesh });
+			};
+
+			// Optimized meshes with at most 65536 vertices read half the index bytes per triangle
+			return mesh.compactIndices.empty() ? hitTestVertices(mesh.indices.data()) : hitTestVertices(mesh.compactIndices.data());
+		}
+
 		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
 		{
 			HitRecord temp{};
 			return HitTest_TriangleMesh(mesh, ray, temp, true);
 		}
+#pragma endregion
+#pragma region AABB HitTest
+		//AABB HIT-TEST (slab test, only checks if the ray segment [min,max] overlaps the box)
+		inline bool HitTest_AABB(const Vector3& minAABB, const Vector3& maxAABB, const Ray& ray)
+		{
+			float tMin{ ray.min };
+			float tMax{ ray.max };
+
+			for (int axis{}; axis < 3; ++axis)
+			{
+				const float inverseDirection{ 1.f / ray.direction[axis] };
+				float t0{ (minAABB[axis] - ray.origin[axis]) * inverseDirection };
+				float t1{ (maxAABB[axis] - ray.origin[axis]) * inverseDirection };
+
+				if (t0 > t1) std::swap(t0, t1);
+
+				tMin = std::max(tMin, t0);
+				tMax = std::min(tMax, t1);
+				if (tMin > tMax)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
 #pragma endregion
 	}
 
@@ -322,79 +522,4 @@ namespace dae
 			return radiance;
 		}
 	}
-
-	namespace Utils
-	{
-		//Just parses vertices and indices
-#pragma warning(push)
-#pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
-		{
-			std::ifstream file(filename);
-			if (!file)
-				return false;
-
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
-			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
-				{
-					// Ignore Comment
-				}
-				else if (sCommand == "v")
-				{
-					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
-					positions.push_back({ x, y, z });
-				}
-				else if (sCommand == "f")
-				{
-					float i0, i1, i2;
-					file >> i0 >> i1 >> i2;
-
-					indices.push_back((int)i0 - 1);
-					indices.push_back((int)i1 - 1);
-					indices.push_back((int)i2 - 1);
-				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
-
-				if (file.eof()) 
-					break;
-			}
-
-			//Precompute normals
-			for (uint64_t index = 0; index < indices.size(); index += 3)
-			{
-				uint32_t i0 = indices[index];
-				uint32_t i1 = indices[index + 1];
-				uint32_t i2 = indices[index + 2];
-
-				Vector3 edgeV0V1 = positions[i1] - positions[i0];
-				Vector3 edgeV0V2 = positions[i2] - positions[i0];
-				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
-
-				if(isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normal.Normalize();
-				if (isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normals.push_back(normal);
-			}
-
-			return true;
-		}
-#pragma warning(pop)
-	}
 }
\ No newline at end of file
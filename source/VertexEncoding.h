@@ -0,0 +1,80 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	// 16 bit position on the grid of a mesh's transformed bounds
+	struct CompactPosition
+	{
+		uint16_t x{};
+		uint16_t y{};
+		uint16_t z{};
+	};
+
+	namespace VertexEncoding
+	{
+		constexpr float g_GridSize{ 65535.f };
+
+		// Distance between two grid positions per axis, 0 for a flat axis
+		inline Vector3 GetGridStep(const Vector3& minAABB, const Vector3& maxAABB)
+		{
+			const Vector3 extent{ maxAABB - minAABB };
+			return Vector3{ extent.x / g_GridSize, extent.y / g_GridSize, extent.z / g_GridSize };
+		}
+
+		inline CompactPosition EncodePosition(const Vector3& position, const Vector3& origin, const Vector3& step)
+		{
+			const auto quantize = [](float offset, float step)
+			{
+				return static_cast<uint16_t>(step > 0.f ? std::clamp(std::round(offset / step), 0.f, g_GridSize) : 0.f);
+			};
+			return CompactPosition{ quantize(position.x - origin.x, step.x), quantize(position.y - origin.y, step.y), quantize(position.z - origin.z, step.z) };
+		}
+
+		inline Vector3 DecodePosition(const CompactPosition& position, const Vector3& origin, const Vector3& step)
+		{
+			return Vector3{ origin.x + position.x * step.x, origin.y + position.y * step.y, origin.z + position.z * step.z };
+		}
+
+		// Octahedral mapping: the unit sphere folded onto a square, 16 bit signed x and y of that square
+		inline uint32_t EncodeNormal(const Vector3& normal)
+		{
+			const float length{ std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z) };
+			if (!(length > 0.f))
+			{
+				return 0;
+			}
+
+			float x{ normal.x / length };
+			float y{ normal.y / length };
+			if (normal.z < 0.f)
+			{
+				const float foldedX{ (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f) };
+				y = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+				x = foldedX;
+			}
+
+			const auto quantize = [](float value) { return static_cast<uint16_t>(static_cast<int16_t>(std::round(std::clamp(value, -1.f, 1.f) * 32767.f))); };
+			return uint32_t{ quantize(x) } | (uint32_t{ quantize(y) } << 16);
+		}
+
+		inline Vector3 DecodeNormal(uint32_t encodedNormal)
+		{
+			float x{ static_cast<int16_t>(encodedNormal & 0xFFFF) / 32767.f };
+			float y{ static_cast<int16_t>(encodedNormal >> 16) / 32767.f };
+			const float z{ 1.f - std::abs(x) - std::abs(y) };
+
+			// Unfold the lower half
+			const float fold{ std::max(-z, 0.f) };
+			x += x >= 0.f ? -fold : fold;
+			y += y >= 0.f ? -fold : fold;
+
+			const float inverseLength{ 1.f / std::sqrt(x * x + y * y + z * z) };
+			return Vector3{ x * inverseLength, y * inverseLength, z * inverseLength };
+		}
+	}
+}
@@ -1,19 +1,31 @@
 //External includes
+#ifndef RAYTRACER_HEADLESS
 #include "vld.h"
 #include "SDL.h"
 #include "SDL_surface.h"
 #undef main
+#endif
 
 //Standard includes
 #include <iostream>
+#include <string>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "Headless.h"
+#include "ImageWriter.h"
 
 using namespace dae;
 
+#ifdef RAYTRACER_HEADLESS
+int main(int argc, char* args[])
+{
+	// Built without SDL, batch rendering only
+	return RunHeadless(argc, args);
+}
+#else
 void ShutDown(SDL_Window* pWindow)
 {
 	SDL_DestroyWindow(pWindow);
@@ -22,9 +34,11 @@ void ShutDown(SDL_Window* pWindow)
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	// Batch rendering, no window
+	if (argc > 1 && std::string{ args[1] } == "--headless")
+	{
+		return RunHeadless(argc, args);
+	}
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -44,6 +58,7 @@ int main(int argc, char* args[])
 	//Initialize "framework"
 	const auto pTimer = new Timer();
 	const auto pRenderer = new Renderer(pWindow);
+	const auto pImageWriter = new ImageWriter();
 
 	//const auto pScene = new Scene_W1();
 	//const auto pScene = new Scene_W2();
@@ -59,6 +74,10 @@ int main(int argc, char* args[])
 	float printTimer = 0.f;
 	bool isLooping = true;
 	bool takeScreenshot = false;
+	bool isRecording = false;
+	uint32_t screenshotCount = 0;
+	uint32_t recordedFrameCount = 0;
+	int zoom = 1;
 	while (isLooping)
 	{
 		//--------- Get input events ---------
@@ -70,9 +89,19 @@ int main(int argc, char* args[])
 			case SDL_QUIT:
 				isLooping = false;
 				break;
+			case SDL_WINDOWEVENT:
+				// Surface content might be lost, trace again
+				if (e.window.event == SDL_WINDOWEVENT_EXPOSED)
+					pRenderer->MarkSettingsChanged();
+				break;
 			case SDL_KEYUP:
 				if(e.key.keysym.scancode == SDL_SCANCODE_X)
 					takeScreenshot = true;
+				if (e.key.keysym.scancode == SDL_SCANCODE_R)
+				{
+					isRecording = !isRecording;
+					std::cout << (isRecording ? "Recording frames..." : "Recording stopped") << std::endl;
+				}
 				break;
 			case SDL_KEYDOWN:
 
@@ -85,6 +114,56 @@ int main(int argc, char* args[])
 				case SDLK_F3:
 					pRenderer->CycleLightingMode();
 					break;
+				case SDLK_F4:
+					pRenderer->ToggleDistributedRendering();
+					break;
+				case SDLK_F5:
+					pRenderer->ToggleAdaptiveAA();
+					break;
+				case SDLK_F6:
+					pRenderer->ToggleSubsampling();
+					break;
+				case SDLK_F7:
+					pRenderer->CycleSubsampleQuality();
+					break;
+				case SDLK_F8:
+					pRenderer->ToggleSubsampleOverlay();
+					break;
+				case SDLK_F9:
+					pRenderer->ToggleProgressive();
+					break;
+				case SDLK_F10:
+					pRenderer->ToggleIncremental();
+					break;
+				case SDLK_F11:
+					pRenderer->ToggleReshade();
+					break;
+				case SDLK_F12:
+					pRenderer->ToggleOriginTerms();
+					break;
+
+				// Zoomed preview: the window shows the center of a 2x/4x larger image
+				case SDLK_z:
+					zoom = zoom == 4 ? 1 : zoom * 2;
+					pRenderer->SetCropWindow(width * zoom, height * zoom, (width * zoom - width) / 2, (height * zoom - height) / 2);
+					std::cout << "Zoom: " << zoom << "x" << std::endl;
+					break;
+
+				// Tone mapping
+				case SDLK_t:
+					pRenderer->CycleToneMapOperator();
+					break;
+				case SDLK_g:
+					pRenderer->ToggleGamma();
+					break;
+
+				// Light intensity
+				case SDLK_PAGEUP:
+					pScene->ScaleLightIntensities(1.1f);
+					break;
+				case SDLK_PAGEDOWN:
+					pScene->ScaleLightIntensities(1.f / 1.1f);
+					break;
 				}
 
 				break;		
@@ -95,7 +174,7 @@ int main(int argc, char* args[])
 		pScene->Update(pTimer);
 
 		//--------- Render ---------
-		pRenderer->Render(pScene);
+		const bool hasRendered{ pRenderer->Render(pScene) };
 
 		//--------- Timer ---------
 		pTimer->Update();
@@ -104,25 +183,53 @@ int main(int argc, char* args[])
 		{
 			printTimer = 0.f;
 			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			if (pRenderer->IsAdaptiveAAEnabled())
+				std::cout << "AA refined: " << pRenderer->GetRefinedPixelFraction() * 100.f << "% of pixels" << std::endl;
+			if (pRenderer->IsIncrementalEnabled())
+				std::cout << "Incremental: retraced " << pRenderer->GetRetracedTileFraction() * 100.f << "% of tiles" << std::endl;
+			if (pRenderer->IsSubsamplingEnabled())
+				std::cout << "Subsampling (step " << pRenderer->GetSubsampleStep() << ") traced: " << pRenderer->GetTracedPixelFraction() * 100.f << "% of pixels" << std::endl;
+			if (!pRenderer->IsOriginTermsEnabled())
+				std::cout << "Primary rays: generic hit tests (F12)" << std::endl;
 		}
 
-		//Save screenshot after full render
+		//Save screenshot after full render, encoded in the background
 		if (takeScreenshot)
 		{
-			if (!pRenderer->SaveBufferToImage())
-				std::cout << "Screenshot saved!" << std::endl;
-			else
-				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
+			const std::string path{ GetNumberedPath("RayTracing_Buffer.png", screenshotCount++) };
+			pRenderer->SaveBufferToImage(*pImageWriter, path);
+			std::cout << "Screenshot queued: " << path << std::endl;
 			takeScreenshot = false;
 		}
+
+		//Every new frame while recording, blocks only when the encoders fall behind
+		if (isRecording && hasRendered)
+		{
+			pRenderer->SaveBufferToImage(*pImageWriter, GetNumberedPath("RayTracing_Frame.png", recordedFrameCount++));
+		}
+
+		//Nothing changed, sleep until the next input event (timer paused so the wait isn't counted as elapsed time)
+		if (!hasRendered)
+		{
+			pTimer->Stop();
+			SDL_WaitEvent(nullptr);
+			pTimer->Start();
+		}
 	}
 	pTimer->Stop();
 
+	//Finish writing queued images
+	pImageWriter->Flush();
+	if (pImageWriter->GetFailedCount() > 0)
+		std::cout << "Something went wrong. " << pImageWriter->GetFailedCount() << " image(s) not saved!" << std::endl;
+
 	//Shutdown "framework"
 	delete pScene;
+	delete pImageWriter;
 	delete pRenderer;
 	delete pTimer;
 
 	ShutDown(pWindow);
 	return 0;
-}
\ No newline at end of file
+}
+#endif